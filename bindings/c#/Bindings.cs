@@ -34,6 +34,9 @@ internal static class Bindings
     [DllImport(Lib)]
     public static extern IntPtr led_matrix_swap_on_vsync(IntPtr matrix, IntPtr canvas);
 
+    [DllImport(Lib)]
+    public static extern IntPtr led_matrix_swap_on_vsync_rgb(IntPtr matrix, IntPtr canvas, in byte rgb, int stride);
+
     [DllImport(Lib)]
     public static extern IntPtr led_matrix_get_canvas(IntPtr matrix);
 
@@ -56,6 +59,9 @@ internal static class Bindings
     public static extern int vertical_draw_text(IntPtr canvas, IntPtr font, int x, int y, byte r, byte g, byte b,
                                                 string utf8_text, int kerning_offset);
 
+    [DllImport(Lib)]
+    public static extern void draw_texts(IntPtr canvas, in InternalLedText texts, int count, ref int advances);
+
     [DllImport(Lib, CharSet = CharSet.Ansi)]
     public static extern void delete_font(IntPtr font);
 
@@ -71,12 +77,30 @@ internal static class Bindings
     public static extern void led_canvas_set_pixels(IntPtr canvas, int x, int y, int width, int height,
                                                     ref Color colors);
 
+    [DllImport(Lib)]
+    public static extern void led_canvas_set_pixels_rgb(IntPtr canvas, int x, int y, int width, int height,
+                                                        in byte rgb, int stride);
+
     [DllImport(Lib)]
     public static extern void led_canvas_clear(IntPtr canvas);
 
     [DllImport(Lib)]
     public static extern void led_canvas_fill(IntPtr canvas, byte r, byte g, byte b);
 
+    [DllImport(Lib)]
+    public static extern void led_canvas_fill_rect(IntPtr canvas, int x, int y, int width, int height,
+                                                   byte r, byte g, byte b);
+
+    [DllImport(Lib)]
+    public static extern void led_canvas_fill_spans(IntPtr canvas, in PixelSpan spans, int count);
+
+    [DllImport(Lib)]
+    public static extern void led_canvas_blit(IntPtr dst, IntPtr src, int src_x, int src_y, int width, int height,
+                                              int dst_x, int dst_y);
+
+    [DllImport(Lib)]
+    public static extern void led_canvas_scroll(IntPtr canvas, int dx, int dy);
+
     [DllImport(Lib)]
     public static extern void draw_circle(IntPtr canvas, int xx, int y, int radius, byte r, byte g, byte b);
 
@@ -0,0 +1,15 @@
+using System.Runtime.InteropServices;
+
+namespace RPiRgbLEDMatrix;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct InternalLedText
+{
+    public IntPtr font;
+    public int x;
+    public int y;
+    public Color color;
+    public int kerning_offset;
+    public int vertical;
+    public IntPtr utf8_text;
+}
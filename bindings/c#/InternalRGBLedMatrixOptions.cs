@@ -2,6 +2,7 @@ using System.Runtime.InteropServices;
 
 namespace RPiRgbLEDMatrix;
 
+// Same layout as struct RGBLedMatrixOptions in include/led-matrix-c.h.
 [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Auto)]
 internal struct InternalRGBLedMatrixOptions
 {
@@ -17,13 +18,16 @@ internal struct InternalRGBLedMatrixOptions
     public int scan_mode;
     public int row_address_type;
     public int multiplexing;
-    public IntPtr led_rgb_sequence;
-    public IntPtr pixel_mapper_config;
-    public IntPtr panel_type;
     public byte disable_hardware_pulsing;
     public byte show_refresh_rate;
     public byte inverse_colors;
+    public IntPtr led_rgb_sequence;
+    public IntPtr pixel_mapper_config;
+    public IntPtr panel_type;
     public int limit_refresh_rate_hz;
+    public byte disable_busy_waiting;
+    public int refresh_priority;
+    public int refresh_cpu;
 
     public InternalRGBLedMatrixOptions(RGBLedMatrixOptions opt)
     {
@@ -46,5 +50,8 @@ internal struct InternalRGBLedMatrixOptions
         brightness = opt.Brightness;
         disable_hardware_pulsing = (byte)(opt.DisableHardwarePulsing ? 1 : 0);
         row_address_type = opt.RowAddressType;
+        disable_busy_waiting = (byte)(opt.DisableBusyWaiting ? 1 : 0);
+        refresh_priority = opt.RefreshPriority;
+        refresh_cpu = opt.RefreshCpu;
     }
 };
@@ -0,0 +1,41 @@
+using System.Runtime.InteropServices;
+
+namespace RPiRgbLEDMatrix;
+
+/// <summary>
+/// A horizontal run of pixels of the same color.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct PixelSpan
+{
+    /// <summary>
+    /// The X coordinate of the first pixel.
+    /// </summary>
+    public int X;
+
+    /// <summary>
+    /// The Y coordinate of the pixels.
+    /// </summary>
+    public int Y;
+
+    /// <summary>
+    /// The number of pixels.
+    /// </summary>
+    public int Length;
+
+    /// <summary>
+    /// The color of the pixels.
+    /// </summary>
+    public Color Color;
+
+    /// <summary>
+    /// Creates a new span of <paramref name="length"/> pixels starting at (<paramref name="x"/>, <paramref name="y"/>).
+    /// </summary>
+    public PixelSpan(int x, int y, int length, Color color)
+    {
+        X = x;
+        Y = y;
+        Length = length;
+        Color = color;
+    }
+}
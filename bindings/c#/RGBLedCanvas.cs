@@ -1,3 +1,7 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Text;
+
 namespace RPiRgbLEDMatrix;
 
 /// <summary>
@@ -52,12 +56,73 @@ public class RGBLedCanvas
         led_canvas_set_pixels(_canvas, x, y, width, height, ref colors[0]);
     }
 
+    /// <summary>
+    /// Copies pixels from a buffer of RGB byte triplets to a rectangle on the canvas,
+    /// e.g. a whole frame rendered elsewhere, in a single call.
+    /// </summary>
+    /// <param name="x">The X coordinate of the top-left pixel of the rectangle.</param>
+    /// <param name="y">The Y coordinate of the top-left pixel of the rectangle.</param>
+    /// <param name="width">Width of the rectangle.</param>
+    /// <param name="height">Height of the rectangle.</param>
+    /// <param name="rgb">Buffer containing the pixels row by row.</param>
+    /// <param name="stride">Bytes from one row to the next; 0 for <c>width * 3</c>.</param>
+    public void SetPixels(int x, int y, int width, int height, ReadOnlySpan<byte> rgb, int stride = 0)
+    {
+        if (stride == 0) stride = width * 3;
+        if (width <= 0 || height <= 0) return;
+        if (stride < width * 3 || rgb.Length < (height - 1) * stride + width * 3)
+            throw new ArgumentOutOfRangeException(nameof(rgb));
+        led_canvas_set_pixels_rgb(_canvas, x, y, width, height, in MemoryMarshal.GetReference(rgb), stride);
+    }
+
     /// <summary>
     /// Sets the color of the entire canvas.
     /// </summary>
     /// <param name="color">New canvas color.</param>
     public void Fill(Color color) => led_canvas_fill(_canvas, color.R, color.G, color.B);
 
+    /// <summary>
+    /// Sets the color of a rectangle.
+    /// </summary>
+    /// <param name="x">The X coordinate of the top-left pixel of the rectangle.</param>
+    /// <param name="y">The Y coordinate of the top-left pixel of the rectangle.</param>
+    /// <param name="width">Width of the rectangle.</param>
+    /// <param name="height">Height of the rectangle.</param>
+    /// <param name="color">New color.</param>
+    public void FillRect(int x, int y, int width, int height, Color color) =>
+        led_canvas_fill_rect(_canvas, x, y, width, height, color.R, color.G, color.B);
+
+    /// <summary>
+    /// Sets the color of many horizontal runs of pixels in a single call.
+    /// </summary>
+    /// <param name="spans">The runs of pixels with their color.</param>
+    public void FillSpans(ReadOnlySpan<PixelSpan> spans)
+    {
+        if (spans.IsEmpty) return;
+        led_canvas_fill_spans(_canvas, in MemoryMarshal.GetReference(spans), spans.Length);
+    }
+
+    /// <summary>
+    /// Copies a rectangle of another canvas of the same matrix, or of this
+    /// canvas. This is much cheaper than setting the pixels again.
+    /// </summary>
+    /// <param name="source">Canvas to copy from.</param>
+    /// <param name="sourceX">The X coordinate of the top-left pixel to copy.</param>
+    /// <param name="sourceY">The Y coordinate of the top-left pixel to copy.</param>
+    /// <param name="width">Width of the rectangle.</param>
+    /// <param name="height">Height of the rectangle.</param>
+    /// <param name="x">The X coordinate of the destination on this canvas.</param>
+    /// <param name="y">The Y coordinate of the destination on this canvas.</param>
+    public void Blit(RGBLedCanvas source, int sourceX, int sourceY, int width, int height, int x, int y) =>
+        led_canvas_blit(_canvas, source._canvas, sourceX, sourceY, width, height, x, y);
+
+    /// <summary>
+    /// Moves the content of the canvas. The uncovered area becomes black.
+    /// </summary>
+    /// <param name="dx">Pixels to move right; negative to move left.</param>
+    /// <param name="dy">Pixels to move down; negative to move up.</param>
+    public void ScrollBy(int dx, int dy) => led_canvas_scroll(_canvas, dx, dy);
+
     /// <summary>
     /// Cleans the entire canvas.
     /// </summary>
@@ -97,4 +162,56 @@ public class RGBLedCanvas
     /// <returns>How many pixels was advanced on the screen.</returns>
     public int DrawText(RGBLedFont font, int x, int y, Color color, string text, int spacing = 0, bool vertical = false) =>
         font.DrawText(_canvas, x, y, color, text, spacing, vertical);
+
+    /// <summary>
+    /// Draws many texts in a single call.
+    /// </summary>
+    /// <param name="texts">The texts to draw.</param>
+    /// <param name="advances">If not empty, receives how many pixels was advanced for each text.</param>
+    public void DrawTexts(ReadOnlySpan<TextItem> texts, Span<int> advances = default)
+    {
+        if (texts.IsEmpty) return;
+        if (!advances.IsEmpty && advances.Length < texts.Length)
+            throw new ArgumentOutOfRangeException(nameof(advances));
+
+        // All strings NUL-terminated in one buffer, pinned while drawing.
+        var offsets = new int[texts.Length];
+        var size = 0;
+        for (var i = 0; i < texts.Length; i++)
+        {
+            offsets[i] = size;
+            size += Encoding.UTF8.GetByteCount(texts[i].Text) + 1;
+        }
+        var utf8 = new byte[size];
+        for (var i = 0; i < texts.Length; i++)
+            Encoding.UTF8.GetBytes(texts[i].Text, 0, texts[i].Text.Length, utf8, offsets[i]);
+
+        var native = new InternalLedText[texts.Length];
+        var handle = GCHandle.Alloc(utf8, GCHandleType.Pinned);
+        try
+        {
+            var strings = handle.AddrOfPinnedObject();
+            for (var i = 0; i < texts.Length; i++)
+            {
+                native[i] = new InternalLedText
+                {
+                    font = texts[i].Font._font,
+                    x = texts[i].X,
+                    y = texts[i].Y,
+                    color = texts[i].Color,
+                    kerning_offset = texts[i].Spacing,
+                    vertical = texts[i].Vertical ? 1 : 0,
+                    utf8_text = strings + offsets[i],
+                };
+            }
+            if (advances.IsEmpty)
+                draw_texts(_canvas, in native[0], native.Length, ref Unsafe.NullRef<int>());
+            else
+                draw_texts(_canvas, in native[0], native.Length, ref advances[0]);
+        }
+        finally
+        {
+            handle.Free();
+        }
+    }
 }
@@ -84,6 +84,21 @@ public class RGBLedMatrix : IDisposable
     public void SwapOnVsync(RGBLedCanvas canvas) =>
         canvas._canvas = led_matrix_swap_on_vsync(matrix, canvas._canvas);
 
+    /// <summary>
+    /// Copies a whole frame of RGB byte triplets to this canvas, then swaps it
+    /// like <see cref="SwapOnVsync(RGBLedCanvas)"/>, in a single call.
+    /// </summary>
+    /// <param name="canvas">Backbuffer canvas to fill and swap.</param>
+    /// <param name="rgb">Buffer containing the pixels row by row.</param>
+    /// <param name="stride">Bytes from one row to the next; 0 for <c>width * 3</c>.</param>
+    public void SwapOnVsync(RGBLedCanvas canvas, ReadOnlySpan<byte> rgb, int stride = 0)
+    {
+        if (stride == 0) stride = canvas.Width * 3;
+        if (stride < canvas.Width * 3 || rgb.Length < (canvas.Height - 1) * stride + canvas.Width * 3)
+            throw new ArgumentOutOfRangeException(nameof(rgb));
+        canvas._canvas = led_matrix_swap_on_vsync_rgb(matrix, canvas._canvas, in MemoryMarshal.GetReference(rgb), stride);
+    }
+
     /// <summary>
     /// The general brightness of the matrix.
     /// </summary>
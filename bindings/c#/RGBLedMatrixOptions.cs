@@ -112,6 +112,24 @@ public struct RGBLedMatrixOptions
     /// </summary>
     public int LimitRefreshRateHz = 0;
 
+    /// <summary>
+    /// Sleep instead of busy waiting when limiting refresh rate. This gives
+    /// slightly less accurate frame timing, but lets the CPU work on other
+    /// processes when waiting.
+    /// </summary>
+    public bool DisableBusyWaiting = false;
+
+    /// <summary>
+    /// Realtime priority of the refresh thread, 1..99. 0: use default (99).
+    /// </summary>
+    public int RefreshPriority = 0;
+
+    /// <summary>
+    /// CPU to run the refresh thread on. 0: use default, which is an isolated
+    /// CPU if there is one, otherwise the last CPU.
+    /// </summary>
+    public int RefreshCpu = 0;
+
     /// <summary>
     /// Slowdown GPIO. Needed for faster Pis/slower panels.
     /// </summary>
@@ -0,0 +1,14 @@
+namespace RPiRgbLEDMatrix;
+
+/// <summary>
+/// A text to be drawn with <see cref="RGBLedCanvas.DrawTexts"/>.
+/// </summary>
+/// <param name="Font">Font to draw text with.</param>
+/// <param name="X">The X coordinate of the starting point.</param>
+/// <param name="Y">The Y coordinate of the starting point.</param>
+/// <param name="Color">The color of the text.</param>
+/// <param name="Text">Text to draw.</param>
+/// <param name="Spacing">Additional spacing between characters.</param>
+/// <param name="Vertical">Whether to draw the text vertically.</param>
+public readonly record struct TextItem(RGBLedFont Font, int X, int Y, Color Color, string Text,
+                                       int Spacing = 0, bool Vertical = false);
@@ -2,6 +2,7 @@
 
 from libcpp cimport bool
 from libc.stdint cimport uint8_t, uint32_t, uintptr_t
+from libc.stdlib cimport malloc, free
 import cython
 
 cdef class Canvas:
@@ -9,6 +10,12 @@ cdef class Canvas:
         raise Exception("Not implemented")
 
     def SetImage(self, image, int offset_x = 0, int offset_y = 0, unsafe=True):
+        if not hasattr(image, "mode"):
+            # Not a PIL image: a NumPy array, memoryview or anything else
+            # providing the buffer protocol.
+            self.SetPixelsBuffer(offset_x, offset_y, image)
+            return
+
         if (image.mode != "RGB"):
             raise Exception("Currently, only RGB mode is supported for SetImage(). Please create images with mode 'RGB' or convert first with image = image.convert('RGB'). Pull requests to support more modes natively are also welcome :)")
 
@@ -18,11 +25,14 @@ cdef class Canvas:
             #however it's super fast and seems to work fine
             #https://groups.google.com/forum/#!topic/cython-users/Dc1ft5W6KM4
             img_width, img_height = image.size
-            self.SetPixelsPillow(offset_x, offset_y, img_width, img_height, image)
+            image.load()
+            if hasattr(image.im, "unsafe_ptrs"):
+                self.SetPixelsPillow(offset_x, offset_y, img_width, img_height, image)
+            else:
+                # Newer Pillow versions don't provide the pointers anymore.
+                self.SetPixelsBuffer(offset_x, offset_y, memoryview(image.tobytes()).cast('B', (img_height, img_width, 3)))
         else:
-            # First implementation of a SetImage(). OPTIMIZE_ME: A more native
-            # implementation that directly reads the buffer and calls the underlying
-            # C functions can certainly be faster.
+            # Slow, but only uses the public PIL API.
             img_width, img_height = image.size
             pixels = image.load()
             for x in range(max(0, -offset_x), min(img_width, self.width - offset_x)):
@@ -33,24 +43,76 @@ cdef class Canvas:
     @cython.boundscheck(False)
     @cython.wraparound(False)
     def SetPixelsPillow(self, int xstart, int ystart, int width, int height, image):
-        cdef cppinc.FrameCanvas* my_canvas = <cppinc.FrameCanvas*>self._getCanvas()
-        cdef int frame_width = my_canvas.width()
-        cdef int frame_height = my_canvas.height()
+        cdef cppinc.Canvas* my_canvas = self._getCanvas()
         cdef int row, col
-        cdef uint8_t r, g, b
         cdef uint32_t **image_ptr
         cdef uint32_t pixel
+        cdef cppinc.Color *row_buffer
         image.load()
         ptr_tmp = dict(image.im.unsafe_ptrs)['image32']
         image_ptr = (<uint32_t **>(<uintptr_t>ptr_tmp))
+        if width <= 0 or height <= 0:
+            return
+
+        # Convert row by row, then hand each to the native SetPixels().
+        row_buffer = <cppinc.Color*>malloc(width * sizeof(cppinc.Color))
+        if row_buffer == NULL:
+            raise MemoryError()
+        with nogil:
+            for row in range(height):
+                for col in range(width):
+                    pixel = image_ptr[row][col]
+                    row_buffer[col].r = (pixel ) & 0xFF
+                    row_buffer[col].g = (pixel >> 8) & 0xFF
+                    row_buffer[col].b = (pixel >> 16) & 0xFF
+                my_canvas.SetPixels(xstart, ystart + row, width, 1, row_buffer)
+        free(row_buffer)
 
-        for col in range(max(0, -xstart), min(width, frame_width - xstart)):
-            for row in range(max(0, -ystart), min(height, frame_height - ystart)):
-                pixel = image_ptr[row][col]
-                r = (pixel ) & 0xFF
-                g = (pixel >> 8) & 0xFF
-                b = (pixel >> 16) & 0xFF
-                my_canvas.SetPixel(xstart+col, ystart+row, r, g, b)
+    @cython.boundscheck(False)
+    @cython.wraparound(False)
+    def SetPixelsBuffer(self, int xstart, int ystart, image):
+        """Set pixels from a height x width x 3 (RGB) or x 4 (RGBA, alpha
+        ignored) array of uint8, e.g. a NumPy array, at xstart, ystart.
+
+        Tightly packed RGB data is passed to the matrix without copying.
+        The GIL is released while the pixels are set."""
+        cdef const uint8_t[:, :, :] pixels = image
+        cdef cppinc.Canvas* my_canvas = self._getCanvas()
+        cdef int height = pixels.shape[0]
+        cdef int width = pixels.shape[1]
+        cdef int channels = pixels.shape[2]
+        cdef int row, col
+        cdef cppinc.Color *row_buffer = NULL
+        if channels != 3 and channels != 4:
+            raise ValueError("Expected an array of height x width x 3 (RGB) or 4 (RGBA) uint8, got %d channels" % channels)
+        if width == 0 or height == 0:
+            return
+
+        # Rows of RGB pixels are already an array of Color.
+        cdef bint packed = (channels == 3 and pixels.strides[2] == 1
+                            and pixels.strides[1] == 3)
+        if packed and pixels.strides[0] == 3 * width:
+            with nogil:
+                my_canvas.SetPixels(xstart, ystart, width, height,
+                                    <const cppinc.Color*>&pixels[0, 0, 0])
+            return
+
+        if not packed:
+            row_buffer = <cppinc.Color*>malloc(width * sizeof(cppinc.Color))
+            if row_buffer == NULL:
+                raise MemoryError()
+        with nogil:
+            for row in range(height):
+                if packed:
+                    my_canvas.SetPixels(xstart, ystart + row, width, 1,
+                                        <const cppinc.Color*>&pixels[row, 0, 0])
+                    continue
+                for col in range(width):
+                    row_buffer[col].r = pixels[row, col, 0]
+                    row_buffer[col].g = pixels[row, col, 1]
+                    row_buffer[col].b = pixels[row, col, 2]
+                my_canvas.SetPixels(xstart, ystart + row, width, 1, row_buffer)
+        free(row_buffer)
 
 cdef class FrameCanvas(Canvas):
     def __dealloc__(self):
@@ -177,6 +239,14 @@ cdef class RGBMatrixOptions:
         def __get__(self): return self.__options.limit_refresh_rate_hz
         def __set__(self, value): self.__options.limit_refresh_rate_hz = value
 
+    property refresh_priority:
+        def __get__(self): return self.__options.refresh_priority
+        def __set__(self, value): self.__options.refresh_priority = value
+
+    property refresh_cpu:
+        def __get__(self): return self.__options.refresh_cpu
+        def __set__(self, value): self.__options.refresh_cpu = value
+
 
     # RuntimeOptions properties
 
@@ -253,7 +323,12 @@ cdef class RGBMatrix(Canvas):
     # If you combine this with RGBMatrixOptions.limit_refresh_rate_hz you can create
     # time-correct animations.
     def SwapOnVSync(self, FrameCanvas newFrame, uint8_t framerate_fraction = 1):
-        return __createFrameCanvas(self.__matrix.SwapOnVSync(newFrame.__canvas, framerate_fraction))
+        cdef cppinc.FrameCanvas* new_canvas = newFrame.__canvas
+        cdef cppinc.FrameCanvas* previous
+        # Let other Python threads work while we wait for the refresh.
+        with nogil:
+            previous = self.__matrix.SwapOnVSync(new_canvas, framerate_fraction)
+        return __createFrameCanvas(previous)
 
     property luminanceCorrect:
         def __get__(self): return self.__matrix.luminance_correct()
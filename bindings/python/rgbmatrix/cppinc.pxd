@@ -6,10 +6,17 @@ from libc.stdint cimport uint8_t, uint32_t
 ########################
 
 cdef extern from "canvas.h" namespace "rgb_matrix":
+    cdef struct Color:
+        Color(uint8_t, uint8_t, uint8_t) except +
+        uint8_t r
+        uint8_t g
+        uint8_t b
+
     cdef cppclass Canvas:
         int width()
         int height()
         void SetPixel(int, int, uint8_t, uint8_t, uint8_t) nogil
+        void SetPixels(int, int, int, int, const Color*) nogil
         void Clear() nogil
         void Fill(uint8_t, uint8_t, uint8_t) nogil
 
@@ -22,7 +29,7 @@ cdef extern from "led-matrix.h" namespace "rgb_matrix":
         void SetBrightness(uint8_t)
         uint8_t brightness()
         FrameCanvas *CreateFrameCanvas()
-        FrameCanvas *SwapOnVSync(FrameCanvas*, uint8_t)
+        FrameCanvas *SwapOnVSync(FrameCanvas*, uint8_t) nogil
 
     cdef cppclass FrameCanvas(Canvas):
         bool SetPWMBits(uint8_t)
@@ -61,6 +68,8 @@ cdef extern from "led-matrix.h" namespace "rgb_matrix::RGBMatrix":
         int multiplexing
         int pwm_dither_bits
         int limit_refresh_rate_hz
+        int refresh_priority
+        int refresh_cpu
 
         bool disable_hardware_pulsing
         bool show_refresh_rate
@@ -71,12 +80,6 @@ cdef extern from "led-matrix.h" namespace "rgb_matrix::RGBMatrix":
         const char *panel_type
 
 cdef extern from "graphics.h" namespace "rgb_matrix":
-    cdef struct Color:
-        Color(uint8_t, uint8_t, uint8_t) except +
-        uint8_t r
-        uint8_t g
-        uint8_t b
-
     cdef cppclass Font:
         Font() except +
         bool LoadFont(const char*)
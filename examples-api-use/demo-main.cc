@@ -7,6 +7,7 @@
 // This is a grab-bag of various demos and not very readable.
 #include "led-matrix.h"
 
+#include "frame-producer.h"
 #include "pixel-mapper.h"
 #include "graphics.h"
 
@@ -54,39 +55,36 @@ private:
  */
 
 // Simple generator that pulses through RGB and White.
-class ColorPulseGenerator : public DemoRunner {
+// Uses the FrameProducer to advance at a steady pace, independent of the
+// refresh rate of the matrix.
+class ColorPulseGenerator : public DemoRunner, private FrameProducer {
 public:
-  ColorPulseGenerator(RGBMatrix *m) : DemoRunner(m), matrix_(m) {
-    off_screen_canvas_ = m->CreateFrameCanvas();
-  }
+  ColorPulseGenerator(RGBMatrix *m) : DemoRunner(m), FrameProducer(m, 200) {}
   void Run() override {
-    uint32_t continuum = 0;
-    while (!interrupt_received) {
-      usleep(5 * 1000);
-      continuum += 1;
-      continuum %= 3 * 255;
-      int r = 0, g = 0, b = 0;
-      if (continuum <= 255) {
-        int c = continuum;
-        b = 255 - c;
-        r = c;
-      } else if (continuum > 255 && continuum <= 511) {
-        int c = continuum - 256;
-        r = 255 - c;
-        g = c;
-      } else {
-        int c = continuum - 512;
-        g = 255 - c;
-        b = c;
-      }
-      off_screen_canvas_->Fill(r, g, b);
-      off_screen_canvas_ = matrix_->SwapOnVSync(off_screen_canvas_);
-    }
+    FrameProducer::Run();
+    PrintStats(stderr);
   }
 
 private:
-  RGBMatrix *const matrix_;
-  FrameCanvas *off_screen_canvas_;
+  bool RenderFrame(FrameCanvas *canvas, uint64_t frame) override {
+    const uint32_t continuum = frame % (3 * 255);
+    int r = 0, g = 0, b = 0;
+    if (continuum <= 255) {
+      int c = continuum;
+      b = 255 - c;
+      r = c;
+    } else if (continuum > 255 && continuum <= 511) {
+      int c = continuum - 256;
+      r = 255 - c;
+      g = c;
+    } else {
+      int c = continuum - 512;
+      g = 255 - c;
+      b = c;
+    }
+    canvas->Fill(r, g, b);
+    return !interrupt_received;
+  }
 };
 
 // Simple generator that pulses through brightness on red, green, blue and white
@@ -290,6 +288,9 @@ public:
   void Run() override {
     const int screen_height = offscreen_->height();
     const int screen_width = offscreen_->width();
+    // The frame currently shown, if it can be reused for the next position.
+    FrameCanvas *shown = NULL;
+    int32_t shown_position = 0;
     while (!interrupt_received) {
       {
         MutexLock l(&mutex_new_image_);
@@ -297,19 +298,37 @@ public:
           current_image_.Delete();
           current_image_ = new_image_;
           new_image_.Reset();
+          shown = NULL;
         }
       }
       if (!current_image_.IsValid()) {
         usleep(100 * 1000);
         continue;
       }
-      for (int x = 0; x < screen_width; ++x) {
+      int first_x = 0;
+      int last_x = screen_width;
+      if (shown
+          && horizontal_position_ == shown_position + scroll_jumps_
+          && abs(scroll_jumps_) < screen_width) {
+        // Only moved a bit: copy what is already shown and only fill in
+        // the columns scrolled in.
+        offscreen_->Blit(*shown, 0, 0, screen_width, screen_height,
+                         -scroll_jumps_, 0);
+        if (scroll_jumps_ > 0) {
+          first_x = screen_width - scroll_jumps_;
+        } else {
+          last_x = -scroll_jumps_;
+        }
+      }
+      for (int x = first_x; x < last_x; ++x) {
         for (int y = 0; y < screen_height; ++y) {
           const Pixel &p = current_image_.getPixel(
             (horizontal_position_ + x) % current_image_.width, y);
           offscreen_->SetPixel(x, y, p.red, p.green, p.blue);
         }
       }
+      shown = offscreen_;
+      shown_position = horizontal_position_;
       offscreen_ = matrix_->SwapOnVSync(offscreen_);
       horizontal_position_ += scroll_jumps_;
       if (horizontal_position_ < 0) horizontal_position_ = current_image_.width;
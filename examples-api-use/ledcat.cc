@@ -6,7 +6,9 @@
 // (but note, that the led-matrix library this depends on is GPL v2)
 
 #include "led-matrix.h"
+#include "frame-ring.h"
 
+#include <getopt.h>
 #include <math.h>
 #include <signal.h>
 #include <stdio.h>
@@ -17,62 +19,117 @@
 
 using rgb_matrix::RGBMatrix;
 using rgb_matrix::Canvas;
+using rgb_matrix::Color;
 
 volatile bool interrupt_received = false;
 static void InterruptHandler(int signo) {
   interrupt_received = true;
 }
 
+// Read a full frame from stdin. Returns false at end of input.
+static bool ReadFrame(uint8_t *buf, ssize_t frame_size) {
+  ssize_t nread;
+  ssize_t total_nread = 0;
+  while ((nread = read(STDIN_FILENO, &buf[total_nread], frame_size - total_nread)) > 0) {
+    if (interrupt_received) {
+      return false;
+    }
+    total_nread += nread;
+  }
+  return total_nread == frame_size;
+}
+
+static void WaitForNextFrame(const struct timespec &start) {
+  struct timespec end;
+  timespec_get(&end, TIME_UTC);
+  long tudiff = (end.tv_nsec / 1000 + end.tv_sec * 1000000) - (start.tv_nsec / 1000 + start.tv_sec * 1000000);
+  if (tudiff < 1000000l / FPS) {
+    usleep(1000000l / FPS - tudiff);
+  }
+}
+
+// Instead of driving the matrix ourselves, read the frames straight into
+// the shared memory of a running led-matrix-daemon (see utils/).
+static int PublishToDaemon(const char *ring_name) {
+  LedFrameRing ring;
+  if (led_frame_ring_open(&ring, ring_name) != 0) {
+    perror("Can't connect to led-matrix-daemon");
+    return 1;
+  }
+  const ssize_t frame_size = ring.header->width * ring.header->height * 3;
+  while (!interrupt_received) {
+    struct timespec start;
+    timespec_get(&start, TIME_UTC);
+
+    uint8_t *buf = led_frame_ring_begin_frame(&ring, 1000);
+    if (buf == NULL) continue;  // Daemon busy; try again.
+    if (!ReadFrame(buf, frame_size)) {
+      break;
+    }
+    led_frame_ring_publish(&ring);
+    WaitForNextFrame(start);
+  }
+  led_frame_ring_close(&ring);
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
   RGBMatrix::Options defaults;
   defaults.hardware_mapping = "regular"; // or e.g. "adafruit-hat"
   defaults.rows = 32;
   defaults.chain_length = 1;
   defaults.parallel = 1;
-  Canvas *canvas = RGBMatrix::CreateFromFlags(&argc, &argv, &defaults);
-  if (canvas == NULL) {
+  rgb_matrix::RuntimeOptions runtime_defaults;
+  if (!rgb_matrix::ParseOptionsFromFlags(&argc, &argv,
+                                         &defaults, &runtime_defaults)) {
+    rgb_matrix::PrintMatrixFlags(stderr);
     return 1;
   }
 
+  const char *ring_name = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "d::")) != -1) {
+    switch (opt) {
+    case 'd':
+      ring_name = optarg ? optarg : LED_FRAME_RING_DEFAULT_NAME;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-d[<shared-memory-name>]] [led-options]\n"
+              "\t-d : Publish to led-matrix-daemon instead of driving the matrix.\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
   // It is always good to set up a signal handler to cleanly exit when we
   // receive a CTRL-C for instance. The DrawOnCanvas() routine is looking
   // for that.
   signal(SIGTERM, InterruptHandler);
   signal(SIGINT, InterruptHandler);
 
+  if (ring_name) {
+    return PublishToDaemon(ring_name);
+  }
+
+  Canvas *canvas = RGBMatrix::CreateFromOptions(defaults, runtime_defaults);
+  if (canvas == NULL) {
+    return 1;
+  }
+
   ssize_t frame_size = canvas->width() * canvas->height() * 3;
   uint8_t buf[frame_size];
 
-  while (1) {
+  while (!interrupt_received) {
     struct timespec start;
     timespec_get(&start, TIME_UTC);
 
-    ssize_t nread;
-    ssize_t total_nread = 0;
-    while ((nread = read(STDIN_FILENO, &buf[total_nread], frame_size - total_nread)) > 0) {
-      if (interrupt_received) {
-        return 1;
-      }
-      total_nread += nread;
-    }
-    if (total_nread < frame_size){
+    if (!ReadFrame(buf, frame_size)) {
       break;
     }
-
-    for (int y = 0; y < canvas->height(); y++) {
-      for (int x = 0; x < canvas->width(); x++) {
-        uint8_t *p = &buf[(y * canvas->width() + x) * 3];
-        uint8_t r = *(p+0), g = *(p+1), b = *(p+2);
-        canvas->SetPixel(x, y, r, g, b);
-      }
-    }
-
-    struct timespec end;
-    timespec_get(&end, TIME_UTC);
-    long tudiff = (end.tv_nsec / 1000 + end.tv_sec * 1000000) - (start.tv_nsec / 1000 + start.tv_sec * 1000000);
-    if (tudiff < 1000000l / FPS) {
-      usleep(1000000l / FPS - tudiff);
-    }
+    // RGB24 has the memory layout of Color.
+    canvas->SetPixels(0, 0, canvas->width(), canvas->height(),
+                      (const Color*)buf);
+    WaitForNextFrame(start);
   }
 
   // Animation finished. Shut down the RGB matrix.
@@ -157,15 +157,17 @@ int main(int argc, char *argv[]) {
 
   int x = x_orig;
   int y = y_orig;
-  int length = 0;
+
+  // Render the text only once. Each scroll step then only needs to copy the
+  // part that is visible.
+  rgb_matrix::TextStrip strip;
+  // length = holds how many pixels our text takes up
+  const int length = strip.SetText(font, line.c_str(), color, bg_color,
+                                   letter_spacing);
 
   while (!interrupt_received && loops != 0) {
     offscreen_canvas->Fill(bg_color.r, bg_color.g, bg_color.b);
-    // length = holds how many pixels our text takes up
-    length = rgb_matrix::DrawText(offscreen_canvas, font,
-                                  x, y + font.baseline(),
-                                  color, nullptr,
-                                  line.c_str(), letter_spacing);
+    strip.Draw(offscreen_canvas, x, y);
 
     if (speed > 0 && --x + length < 0) {
       x = x_orig;
@@ -18,6 +18,15 @@
 #include <stdint.h>
 
 namespace rgb_matrix {
+// A 24bpp color. An array of Colors is a packed RGB24 image.
+struct Color {
+  Color() : r(0), g(0), b(0) {}
+  Color(uint8_t rr, uint8_t gg, uint8_t bb) : r(rr), g(gg), b(bb) {}
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
 // An interface for things a Canvas can do. The RGBMatrix implements this
 // interface, so you can use it directly wherever a canvas is needed.
 //
@@ -41,6 +50,30 @@ public:
   virtual void SetPixel(int x, int y,
                         uint8_t red, uint8_t green, uint8_t blue) = 0;
 
+  // Set a rectangle of pixels at (x,y) from "colors", which contains
+  // width * height colors row by row. Pixels outside the canvas are skipped.
+  // Implementations can do this a lot faster than with SetPixel() calls.
+  virtual void SetPixels(int x, int y, int width, int height,
+                         const Color *colors) {
+    for (int iy = 0; iy < height; ++iy) {
+      for (int ix = 0; ix < width; ++ix, ++colors) {
+        SetPixel(x + ix, y + iy, colors->r, colors->g, colors->b);
+      }
+    }
+  }
+
+  // Fill the rectangle at (x,y) with given 24bpp color. Pixels outside the
+  // canvas are skipped. Implementations can do this a lot faster than with
+  // SetPixel() calls.
+  virtual void FillRect(int x, int y, int width, int height,
+                        uint8_t red, uint8_t green, uint8_t blue) {
+    for (int iy = y; iy < y + height; ++iy) {
+      for (int ix = x; ix < x + width; ++ix) {
+        SetPixel(ix, iy, red, green, blue);
+      }
+    }
+  }
+
   // Clear screen to be all black.
   virtual void Clear() = 0;
 
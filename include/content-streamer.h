@@ -11,6 +11,22 @@
 // These abstractions are used in util/led-image-viewer.cc to read and
 // write such animations to disk. It is also used in util/video-viewer.cc
 // to write a version to disk that then can be played with the led-image-viewer.
+//
+// Frames carry a presentation timestamp, and streams can have non-frame data
+// chunks interleaved, e.g. the PCM audio a pre-rendered audio-reactive show
+// was made for, or analysis results such as beats. A player can slave a
+// PlaybackClock to its audio output and show frames at their timestamp, so
+// that picture and sound don't drift apart.
+//
+// Streams can also be written as portable RGB frames. These don't depend on
+// hardware mapping, pixel mappers or GPIO width, so a show can be rendered
+// once and deployed to differently wired displays. They are transcoded to
+// the native representation while reading; use TranscodeStream() to do that
+// once up-front.
+//
+// A stream can hold several named segments, e.g. the clips of a show
+// playlist, each played a given number of times before moving on to the
+// next without a gap. Streams can also simply be concatenated with 'cat'.
 
 #ifndef RPI_CONTENT_STREAMER_H
 #define RPI_CONTENT_STREAMER_H
@@ -20,9 +36,12 @@
 #include <sys/types.h>
 
 #include <string>
+#include <vector>
 
 namespace rgb_matrix {
+class Canvas;
 class FrameCanvas;
+struct Color;
 
 // An abstraction of a data stream. Two implementations exist for files and
 // an in-memory representation, but this allows your own implementation, e.g.
@@ -41,6 +60,13 @@ public:
   // Write bytes from buffer. Similar to Posix behavior that allows short
   // writes.
   virtual ssize_t Append(const void *buf, size_t count) = 0;
+
+  // Optional random access, needed to loop segments and to build an index.
+  // Current read position, or -1 if not supported.
+  virtual int64_t Tell() { return -1; }
+
+  // Set read position. Returns false if not supported.
+  virtual bool Seek(int64_t pos) { return false; }
 };
 
 class FileStreamIO : public StreamIO {
@@ -51,6 +77,8 @@ public:
   void Rewind() final;
   ssize_t Read(void *buf, size_t count) final;
   ssize_t Append(const void *buf, size_t count) final;
+  int64_t Tell() final;
+  bool Seek(int64_t pos) final;
 
 private:
   const int fd_;
@@ -62,10 +90,12 @@ public:
   void Rewind() final;
   ssize_t Read(void *buf, size_t count) final;
   ssize_t Append(const void *buf, size_t count) final;
+  int64_t Tell() final { return pos_; }
+  bool Seek(int64_t pos) final;
 
 private:
   std::string buffer_;  // super simplistic.
-  size_t pos_;
+  size_t pos_ = 0;
 };
 
 // Just a view around the memory, possibly a memory mapped file.
@@ -83,26 +113,102 @@ public:
   // No append, this is purely read-only.
   ssize_t Append(const void *buf, size_t count) final { return -1; }
 
+  int64_t Tell() final { return pos_ - buffer_; }
+  bool Seek(int64_t pos) final;
+
 private:
   char *buffer_;
   char *end_;
   char *pos_;
 };
 
+// A chunk of non-frame data interleaved with the frames of a stream.
+struct StreamDataChunk {
+  enum Type {
+    PCM_S16LE = 1,   // Interleaved signed 16 bit little endian samples.
+    ANALYSIS  = 2,   // Application defined analysis data, e.g. beats.
+  };
+  uint32_t type;
+  uint32_t sample_rate;   // PCM: samples per second per channel.
+  uint32_t channels;      // PCM: number of interleaved channels.
+  uint64_t presentation_time_us;  // Media time of the first sample.
+  const void *data;
+  size_t size;
+};
+
+// Receives data chunks while a StreamReader reads frames.
+class StreamDataListener {
+public:
+  virtual ~StreamDataListener() {}
+
+  // Called for each data chunk in the order they appear in the stream. The
+  // data is only valid for the duration of the call.
+  virtual void OnStreamData(const StreamDataChunk &chunk) = 0;
+
+  // Called when a new named segment starts.
+  virtual void OnStreamSegment(const std::string &name, int loops) {}
+};
+
+// A segment as found by StreamReader::BuildIndex().
+struct StreamSegment {
+  std::string name;
+  int loops;              // How often to play; negative for forever.
+  int frames;             // Number of frames in one loop.
+  uint64_t duration_us;   // Sum of hold times of one loop.
+  int64_t file_header_offset;  // Stream header the segment belongs to.
+  int64_t offset;              // Position of first chunk in segment.
+};
+
 class StreamWriter {
 public:
   // Does not take ownership of StreamIO
   StreamWriter(StreamIO *io);
 
   // Stream out given canvas at the given time. "hold_time_us" indicates
-  // for how long this frame is to be shown in microseconds.
+  // for how long this frame is to be shown in microseconds. The
+  // presentation time is the sum of all hold times before.
   bool Stream(const FrameCanvas &frame, uint32_t hold_time_us);
 
+  // Stream out given canvas with an explicit presentation time in
+  // microseconds since the start of the stream.
+  bool Stream(const FrameCanvas &frame, uint32_t hold_time_us,
+              uint64_t presentation_time_us);
+
+  // Stream out a portable RGB frame of "width" x "height" pixels, row by
+  // row. A stream contains either native or RGB frames, so don't mix with
+  // Stream() calls.
+  bool StreamRGB(const Color *pixels, int width, int height,
+                 uint32_t hold_time_us);
+  bool StreamRGB(const Color *pixels, int width, int height,
+                 uint32_t hold_time_us, uint64_t presentation_time_us);
+
+  // Start a new named segment. All following frames belong to it until the
+  // next segment starts. The reader plays it "loops" times before it
+  // continues with the next segment; a negative value loops forever.
+  // The segment is only written with its first frame or data chunk; a
+  // segment that ends before that is dropped.
+  bool BeginSegment(const std::string &name, int loops = 1);
+
+  // Interleave a data chunk with the frames. Best written just before the
+  // frame that is shown at the chunk's presentation time, so that a player
+  // receives it before it is needed.
+  bool StreamData(const StreamDataChunk &chunk);
+
+  // Presentation time of the next frame if not given explicitly.
+  uint64_t presentation_time_us() const { return next_presentation_time_us_; }
+
 private:
-  void WriteFileHeader(const FrameCanvas &frame, size_t len);
+  void WriteFileHeader(int width, int height, size_t len, bool is_rgb);
+  bool WriteFrame(const void *data, size_t len, uint32_t hold_time_us,
+                  uint64_t presentation_time_us);
+  bool WritePendingSegment();
 
   StreamIO *const io_;
   bool header_written_;
+  bool is_rgb_;
+  uint64_t next_presentation_time_us_;
+  std::string pending_data_;  // Data chunks written before the file header.
+  std::string pending_segment_;  // Segment header without frames yet.
 };
 
 class StreamReader {
@@ -116,21 +222,124 @@ public:
 
   // Get next frame and its timestamp. Returns 'false' if there is an error
   // or end of stream reached..
+  // Data chunks found on the way are passed to the data listener, if any.
+  // Segments are repeated according to their loop count if the StreamIO
+  // supports Seek(). Timestamps continue to increase across segment
+  // boundaries and loops.
   bool GetNext(FrameCanvas *frame, uint32_t* hold_time_us);
 
+  // Like GetNext(), but for portable RGB streams only: the frame can be
+  // written to any Canvas, e.g. a Layer of a LayerCompositor.
+  bool GetNextRGB(Canvas *canvas, uint32_t* hold_time_us);
+
+  // Enable or disable repeating segments according to their loop count.
+  // Default is on. If off, every segment is read once.
+  void SetLoopSegments(bool on) { loop_segments_ = on; }
+
+  // Scan the stream and store all segments in "index". Concatenated streams
+  // or frames before the first named segment show up as unnamed segments.
+  // Needs Tell() and Seek(). Returns false if not supported or on error.
+  // Rewinds the stream.
+  bool BuildIndex(std::vector<StreamSegment> *index);
+
+  // Continue playing at the start of the given segment with the next
+  // GetNext().
+  void SeekToSegment(const StreamSegment &segment);
+
+  // Name of the segment the last frame came from.
+  const std::string &segment_name() const { return segment_name_; }
+
+  // Set listener to receive interleaved data chunks. Does not take
+  // ownership. Without listener, data chunks are skipped.
+  void SetDataListener(StreamDataListener *listener) { listener_ = listener; }
+
+  // Presentation time in microseconds of the frame last returned by
+  // GetNext(). For streams written before timestamps were stored, this is
+  // derived from the hold times.
+  uint64_t presentation_time_us() const { return presentation_time_us_; }
+
+  // Returns true if this is a portable RGB stream. Only valid after the
+  // first GetNext().
+  bool is_rgb() const { return is_rgb_; }
+
+  // Returns true if reading stopped because the stream is corrupt or
+  // truncated, not because its end was reached.
+  bool has_error() const { return state_ == STREAM_ERROR; }
+
 private:
   enum State {
     STREAM_AT_BEGIN,
     STREAM_READING,
     STREAM_ERROR,
   };
-  bool ReadFileHeader(const FrameCanvas &frame);
+  bool ReadFrame(const Canvas &frame, uint32_t* hold_time_us);
+  void CopyRGBFrame(Canvas *canvas) const;
+  bool ReadFileHeader(const Canvas &frame);
+  // Start reading frames of the given format.
+  void SetFormat(bool is_rgb, int width, int height, bool has_timestamps,
+                 size_t buf_size);
+  void StartSegment(const std::string &name, int loops);
+  bool RepeatSegment();
+  uint64_t AdjustTime(uint64_t presentation_time_us);
 
   StreamIO *io_;
   size_t frame_buf_size_;
   State state_;
+  bool is_rgb_;
+  int rgb_width_;
+  int rgb_height_;
+  bool has_timestamps_;
+  uint64_t presentation_time_us_;
+  uint64_t next_derived_time_us_;
+  StreamDataListener *listener_;
+
+  bool loop_segments_;
+  std::string segment_name_;
+  int segment_loops_left_;
+  int64_t segment_start_;
+  bool segment_has_frames_;
+  bool time_discontinuity_;
+  int64_t time_offset_us_;
+  bool has_pending_seek_;
+  StreamSegment pending_seek_;
 
-  char *header_frame_buffer_;
+  char *frame_buffer_;
+  std::string data_buffer_;
+};
+
+// Read all frames and data chunks from "in" and write them in the native
+// representation of "scratch" to "out", e.g. to convert a portable RGB
+// stream once on load instead of on every playback. "scratch" needs to be
+// an off-screen canvas of the RGBMatrix the result will be played on.
+// Returns number of frames written or -1 on error, e.g. if "in" is
+// truncated; "out" then only holds part of the stream.
+int TranscodeStream(StreamIO *in, FrameCanvas *scratch, StreamIO *out);
+
+// Media clock to show a stream's frames at their presentation time.
+// By default it runs on the monotonic system clock. A player that outputs
+// the stream's audio can slave it to the audio device by regularly calling
+// SyncTo() with the media time of the sample that is currently audible.
+// Not thread-safe; call from the playback thread.
+class PlaybackClock {
+public:
+  PlaybackClock();
+
+  // (Re-)start clock at the given media time.
+  void Start(uint64_t media_time_us = 0);
+
+  // Current media time in microseconds.
+  uint64_t Now() const;
+
+  // Set the current media time from a master clock, e.g. derived from the
+  // number of samples an audio device has played.
+  void SyncTo(uint64_t media_time_us);
+
+  // Sleep until the given media time is reached. Returns how many
+  // microseconds we are late, which is 0 if we were early enough.
+  uint64_t WaitUntil(uint64_t media_time_us) const;
+
+private:
+  int64_t offset_us_;  // media time = monotonic time + offset
 };
 }
 
@@ -0,0 +1,128 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+// Produce frames at a steady frame rate, without hand-tuned sleeps.
+//
+// Implement RenderFrame(), which draws one frame into an off-screen
+// FrameCanvas. The FrameProducer renders frames ahead of time in a separate
+// thread and shows each at its deadline with SwapOnVSync(). Frames that
+// can't be rendered in time are skipped, so animations keep their speed
+// even if the CPU is busy. Example:
+/*
+  class MyAnimation : public FrameProducer {
+  public:
+    MyAnimation(RGBMatrix *m) : FrameProducer(m, 60.0) {}
+    virtual bool RenderFrame(FrameCanvas *canvas, uint64_t frame) {
+      canvas->Fill(frame % 256, 0, 0);
+      return !interrupt_received;
+    }
+  };
+
+  MyAnimation animation(matrix);
+  animation.Run();   // Returns once RenderFrame() returned false.
+*/
+
+#ifndef RPI_FRAME_PRODUCER_H
+#define RPI_FRAME_PRODUCER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include <deque>
+#include <vector>
+
+#include "led-matrix.h"
+#include "thread.h"
+
+namespace rgb_matrix {
+// Statistics of a FrameProducer since Run() started.
+struct FrameStats {
+  uint64_t rendered;   // Frames rendered.
+  uint64_t presented;  // Frames shown on the matrix.
+  uint64_t late;       // Frames shown more than a frame period too late.
+  uint64_t dropped;    // Frames skipped as their deadline had passed.
+
+  // Render time percentiles in microseconds over the most recent frames.
+  int64_t render_p50_usec;
+  int64_t render_p90_usec;
+  int64_t render_p99_usec;
+  int64_t render_max_usec;
+};
+
+class FrameProducer {
+public:
+  // Show frames at "target_fps". Up to "render_ahead" frames are rendered
+  // in advance; with 0, frames are rendered and shown one after another in
+  // the thread calling Run(). "vsync_multiple" is passed to SwapOnVSync().
+  FrameProducer(RGBMatrix *matrix, float target_fps, int render_ahead = 1,
+                unsigned vsync_multiple = 1);
+  virtual ~FrameProducer();
+
+  // Draw frame number "frame" into the off-screen "canvas". The canvas
+  // contains an earlier frame, not necessarily the previous one.
+  // With render_ahead > 0, this is called from a separate thread.
+  // Return false to stop.
+  virtual bool RenderFrame(FrameCanvas *canvas, uint64_t frame) = 0;
+
+  // Render and show frames until RenderFrame() returns false.
+  void Run();
+
+  FrameStats GetStats() const;
+  void PrintStats(FILE *out) const;
+
+  float target_fps() const { return 1e6 / period_usec_; }
+
+private:
+  class RenderThread;
+  struct QueuedFrame {
+    FrameCanvas *canvas;
+    uint64_t frame;
+  };
+
+  FrameProducer(const FrameProducer&);  // No copy.
+
+  int64_t Deadline(uint64_t frame) const {
+    return start_usec_ + (int64_t)frame * period_usec_;
+  }
+  // Render the next frame that can still be shown in time into "canvas".
+  bool RenderNext(FrameCanvas *canvas, uint64_t *frame);
+  void Present(FrameCanvas *canvas, uint64_t frame);
+  void RenderLoop();
+
+  RGBMatrix *const matrix_;
+  const int64_t period_usec_;
+  const int render_ahead_;
+  const unsigned vsync_multiple_;
+
+  int64_t start_usec_;
+  uint64_t next_frame_;       // Only accessed by the rendering thread.
+
+  mutable Mutex mutex_;
+  pthread_cond_t queue_changed_;
+  std::vector<FrameCanvas*> free_;  // Canvases available for rendering.
+  std::deque<QueuedFrame> queue_;   // Rendered, waiting for their deadline.
+  bool rendering_;                  // False once RenderFrame() returned false.
+
+  // Statistics, guarded by mutex_.
+  uint64_t rendered_;
+  uint64_t presented_;
+  uint64_t late_;
+  uint64_t dropped_;
+  std::vector<int64_t> render_usec_;  // Ring buffer of recent render times.
+};
+}  // namespace rgb_matrix
+
+#endif  // RPI_FRAME_PRODUCER_H
@@ -0,0 +1,183 @@
+/* -*- mode: c; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+ * Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+ */
+
+/*
+ * Shared memory protocol between the led-matrix-daemon (utils/), which owns
+ * the matrix hardware, and a process publishing frames to it. The producer
+ * writes RGB pixels straight into the shared memory; it doesn't need root
+ * nor does it have to initialize the panels. Producers can come and go
+ * while the daemon keeps showing the last frame.
+ *
+ * Layout of the POSIX shared memory object (default name
+ * LED_FRAME_RING_DEFAULT_NAME): a struct LedFrameRingHeader, followed by
+ * "slot_count" frame slots starting at offset "first_slot", each
+ * "slot_stride" bytes apart. A frame is width * height RGB24 pixels, row by
+ * row, top left first.
+ *
+ * Frame number n (counting from 0) goes to slot n % slot_count. Publishing:
+ *   1. Wait until write_seq - read_seq < slot_count; the slot is then not
+ *      in use by the daemon anymore.
+ *   2. Fill slot write_seq % slot_count.
+ *   3. Increment write_seq (release semantics) and FUTEX_WAKE it, which is
+ *      the doorbell the daemon waits on.
+ * The daemon shows the newest published frame; frames published faster
+ * than it can show are skipped. After it is done with frames, it updates
+ * read_seq and does a FUTEX_WAKE on it, so a producer can wait for free
+ * slots with FUTEX_WAIT.
+ *
+ * The struct layout is fixed, so this can be used from any language that
+ * can map shared memory. From C and C++, use the functions below. They need
+ * POSIX and Linux functions that strict ISO C modes such as -std=c99 hide;
+ * this header asks for them with _GNU_SOURCE, which only works if it is
+ * included before any system header. Otherwise define _GNU_SOURCE yourself
+ * or compile with -std=gnu99 or later.
+ */
+
+#ifndef RPI_RGBMATRIX_FRAME_RING_H
+#define RPI_RGBMATRIX_FRAME_RING_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  /* syscall(), kill(), struct timespec */
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LED_FRAME_RING_DEFAULT_NAME "/rgb-matrix-frames"
+#define LED_FRAME_RING_MAGIC   0x474e5246  /* "FRNG" */
+#define LED_FRAME_RING_VERSION 1
+
+struct LedFrameRingHeader {
+  uint32_t magic;        /* LED_FRAME_RING_MAGIC */
+  uint32_t version;      /* LED_FRAME_RING_VERSION */
+  uint32_t width;        /* Frame size in pixels. */
+  uint32_t height;
+  uint32_t slot_count;   /* Number of frame slots. */
+  uint32_t slot_stride;  /* Bytes from one slot to the next. */
+  uint32_t first_slot;   /* Offset of slot 0 from start of shared memory. */
+  uint32_t total_size;   /* Size of the shared memory. */
+
+  uint32_t write_seq;    /* Frames published. Written by the producer. */
+  uint32_t read_seq;     /* Frames done with. Written by the daemon. */
+  int32_t producer_pid;  /* Process publishing frames; 0 if none. */
+  int32_t daemon_pid;
+};
+
+/* A mapped frame ring, as seen by a producer. */
+struct LedFrameRing {
+  struct LedFrameRingHeader *header;
+  size_t size;
+};
+
+static inline long led_frame_ring_futex(uint32_t *addr, int op, uint32_t val,
+                                        const struct timespec *timeout) {
+  return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+/* Pixels of slot "slot". */
+static inline uint8_t *led_frame_ring_slot(const struct LedFrameRingHeader *h,
+                                           uint32_t slot) {
+  return (uint8_t*)h + h->first_slot + (size_t)slot * h->slot_stride;
+}
+
+/* Connect to the daemon's frame ring "name" as the producer.
+ * Returns 0 on success, -1 with errno set otherwise; EBUSY if another
+ * process is publishing frames already. */
+static inline int led_frame_ring_open(struct LedFrameRing *ring,
+                                      const char *name) {
+  struct stat st;
+  const int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) return -1;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(*ring->header)) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+  ring->size = st.st_size;
+  ring->header = (struct LedFrameRingHeader*)
+    mmap(NULL, ring->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ring->header == MAP_FAILED) return -1;
+
+  struct LedFrameRingHeader *const h = ring->header;
+  if (h->magic != LED_FRAME_RING_MAGIC || h->version != LED_FRAME_RING_VERSION
+      || h->total_size > ring->size) {
+    munmap(h, ring->size);
+    errno = EPROTO;
+    return -1;
+  }
+
+  /* Become the producer, unless another live process is. */
+  int32_t expected = 0;
+  while (!__atomic_compare_exchange_n(&h->producer_pid, &expected, getpid(),
+                                      0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    if (kill(expected, 0) == 0 || errno != ESRCH) {
+      munmap(h, ring->size);
+      errno = EBUSY;
+      return -1;
+    }
+    /* Left over from a producer that died; take over. */
+  }
+  return 0;
+}
+
+/* Stop being the producer and unmap. */
+static inline void led_frame_ring_close(struct LedFrameRing *ring) {
+  __atomic_store_n(&ring->header->producer_pid, 0, __ATOMIC_RELEASE);
+  munmap(ring->header, ring->size);
+  ring->header = NULL;
+}
+
+/* Get the pixels of the next frame to fill, width * height RGB24.
+ * If all slots are in use, waits for up to "timeout_ms" milliseconds for
+ * the daemon to catch up (forever if negative). Returns NULL on timeout. */
+static inline uint8_t *led_frame_ring_begin_frame(struct LedFrameRing *ring,
+                                                  int timeout_ms) {
+  struct LedFrameRingHeader *const h = ring->header;
+  const uint32_t seq = h->write_seq;  /* Only we write it. */
+  struct timespec timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  for (;;) {
+    const uint32_t read_seq = __atomic_load_n(&h->read_seq, __ATOMIC_ACQUIRE);
+    if (seq - read_seq < h->slot_count)
+      return led_frame_ring_slot(h, seq % h->slot_count);
+    if (timeout_ms == 0)
+      return NULL;
+    if (led_frame_ring_futex(&h->read_seq, FUTEX_WAIT, read_seq,
+                             timeout_ms < 0 ? NULL : &timeout) < 0
+        && errno == ETIMEDOUT) {
+      return NULL;
+    }
+  }
+}
+
+/* Publish the frame filled after led_frame_ring_begin_frame(). */
+static inline void led_frame_ring_publish(struct LedFrameRing *ring) {
+  __atomic_add_fetch(&ring->header->write_seq, 1, __ATOMIC_RELEASE);
+  led_frame_ring_futex(&ring->header->write_seq, FUTEX_WAKE, 1, NULL);
+}
+
+#endif  /* RPI_RGBMATRIX_FRAME_RING_H */
@@ -13,16 +13,9 @@
 #include <stddef.h>
 
 #include <map>
+#include <vector>
 
 namespace rgb_matrix {
-struct Color {
-  Color() : r(0), g(0), b(0) {}
-  Color(uint8_t rr, uint8_t gg, uint8_t bb) : r(rr), g(gg), b(bb) {}
-  uint8_t r;
-  uint8_t g;
-  uint8_t b;
-};
-
 // Font loading bdf files. If this ever becomes more types, just make virtual
 // base class.
 class Font {
@@ -74,10 +67,12 @@ private:
   typedef std::map<uint32_t, Glyph*> CodepointGlyphMap;
 
   const Glyph *FindGlyph(uint32_t codepoint) const;
+  void UpdateLatin1Lookup();
 
   int font_height_;
   int base_line_;
   CodepointGlyphMap glyphs_;
+  const Glyph *latin1_glyphs_[256];  // Fast path for the most common ones.
 };
 
 // -- Some utility functions.
@@ -133,12 +128,72 @@ int VerticalDrawText(Canvas *c, const Font &font, int x, int y,
                      const Color &color, const Color *background_color,
                      const char *utf8_text, int kerning_offset = 0);
 
+// Text that is rendered only once into an off-screen strip, e.g. for a
+// scrolling ticker. Drawing the strip then only copies the visible part to
+// the canvas row by row, which is a lot cheaper than rendering the text
+// again for every scroll step.
+class TextStrip {
+public:
+  TextStrip();
+
+  // Render "utf8_text" with "font" in "color" on "background_color",
+  // replacing the previous content. If "outline_font" is given (see
+  // Font::CreateOutlineFont()), the text gets an outline in "outline_color".
+  // Returns how many pixels the text advances, like DrawText().
+  int SetText(const Font &font, const char *utf8_text,
+              const Color &color, const Color &background_color,
+              int kerning_offset = 0,
+              const Font *outline_font = NULL,
+              const Color &outline_color = Color());
+
+  // Size of the strip. With outline this includes one extra pixel on each
+  // side.
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // Draw the strip to the canvas, with "x", "y" being the same position
+  // DrawText() would get, except that "y" is the top, not the baseline.
+  void Draw(Canvas *c, int x, int y) const;
+
+  // Like Draw(), but only touch the "clip_width" canvas columns starting at
+  // "clip_x", e.g. the ones uncovered by FrameCanvas::Blit() when scrolling.
+  void DrawColumns(Canvas *c, int x, int y, int clip_x, int clip_width) const;
+
+private:
+  int width_;
+  int height_;
+  int padding_;   // Extra pixels around for the outline.
+  std::vector<Color> pixels_;
+};
+
 // Draw a circle centered at "x", "y", with a radius of "radius" and with "color"
 void DrawCircle(Canvas *c, int x, int y, int radius, const Color &color);
 
 // Draw a line from "x0", "y0" to "x1", "y1" and with "color"
 void DrawLine(Canvas *c, int x0, int y0, int x1, int y1, const Color &color);
 
+// The following fill whole spans with Canvas::FillRect(), which for a
+// FrameCanvas maps the color only once per span instead of for each pixel.
+
+// Fill rectangle with top left corner at "x", "y" with "color".
+void FillRect(Canvas *c, int x, int y, int width, int height,
+              const Color &color);
+
+// Fill horizontal span from "x0" to "x1" (inclusive) in row "y".
+void FillHorizontalSpan(Canvas *c, int x0, int x1, int y, const Color &color);
+
+// Fill vertical span from "y0" to "y1" (inclusive) in column "x".
+void FillVerticalSpan(Canvas *c, int x, int y0, int y1, const Color &color);
+
+// Fill a circle centered at "x", "y", with a radius of "radius". Covers the
+// same pixels as DrawCircle() and everything inside.
+void FillCircle(Canvas *c, int x, int y, int radius, const Color &color);
+
+// Fill polygon with "count" corners given in "xs" and "ys" using the
+// even-odd rule, so it also works for non-convex polygons.
+void FillPolygon(Canvas *c, const int *xs, const int *ys, int count,
+                 const Color &color);
+
 }  // namespace rgb_matrix
 
 #endif  // RPI_GRAPHICS_H
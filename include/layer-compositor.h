@@ -0,0 +1,144 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+// Compose content from several independently drawn layers, e.g. a video
+// with beat flashes and text on top, without redrawing everything.
+//
+// Each layer is a Canvas with an alpha channel, an opacity and a blend
+// mode. The compositor blends them bottom to top into a single RGB image
+// that is then written to the target canvas with one SetPixels() call.
+// Layers that did not change since the last Render() are not blended again,
+// so a static background costs nothing per frame.
+
+#ifndef RPI_LAYER_COMPOSITOR_H
+#define RPI_LAYER_COMPOSITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "canvas.h"
+
+namespace rgb_matrix {
+// A color with alpha. Alpha 0 is fully transparent, 255 fully opaque.
+struct RGBAColor {
+  RGBAColor() : r(0), g(0), b(0), a(0) {}
+  RGBAColor(uint8_t rr, uint8_t gg, uint8_t bb, uint8_t aa = 255)
+    : r(rr), g(gg), b(bb), a(aa) {}
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  uint8_t a;
+};
+
+class LayerCompositor;
+
+// A layer of the LayerCompositor. As it is a Canvas, all the functions in
+// graphics.h can draw into it. Pixels set with the Canvas methods are
+// opaque; Clear() makes the layer fully transparent.
+class Layer : public Canvas {
+public:
+  enum BlendMode {
+    BLEND_NORMAL,    // Layer covers what is below.
+    BLEND_ADD,       // Add colors, e.g. for flashes and glow.
+    BLEND_MULTIPLY,  // Darken what is below.
+    BLEND_SCREEN,    // Lighten what is below.
+  };
+
+  // Opacity of the whole layer, multiplied with the alpha of each pixel.
+  void set_opacity(uint8_t opacity);
+  uint8_t opacity() const { return opacity_; }
+
+  void set_blend_mode(BlendMode mode);
+  BlendMode blend_mode() const { return mode_; }
+
+  // Invisible layers are skipped.
+  void set_visible(bool visible);
+  bool visible() const { return visible_; }
+
+  void SetPixelRGBA(int x, int y, const RGBAColor &color);
+
+  // Direct access to the width * height pixels, row by row. Call
+  // MarkChanged() after modifying them.
+  RGBAColor *pixels() { return pixels_.data(); }
+  void MarkChanged() { changed_ = true; }
+
+  // -- Canvas interface.
+  virtual int width() const { return width_; }
+  virtual int height() const { return height_; }
+  virtual void SetPixel(int x, int y,
+                        uint8_t red, uint8_t green, uint8_t blue);
+  virtual void SetPixels(int x, int y, int width, int height,
+                         const Color *colors);
+  virtual void FillRect(int x, int y, int width, int height,
+                        uint8_t red, uint8_t green, uint8_t blue);
+  virtual void Clear();
+  virtual void Fill(uint8_t red, uint8_t green, uint8_t blue);
+
+private:
+  friend class LayerCompositor;
+
+  Layer(int width, int height, BlendMode mode, uint8_t opacity);
+  Layer(const Layer&);  // No copy.
+
+  const int width_;
+  const int height_;
+  BlendMode mode_;
+  uint8_t opacity_;
+  bool visible_;
+  bool changed_;     // Since last LayerCompositor::Render()
+  std::vector<RGBAColor> pixels_;
+};
+
+class LayerCompositor {
+public:
+  LayerCompositor(int width, int height);
+  ~LayerCompositor();
+
+  // Add a new, fully transparent, layer on top of all others. The layer is
+  // owned by the compositor.
+  Layer *AddLayer(Layer::BlendMode mode = Layer::BLEND_NORMAL,
+                  uint8_t opacity = 255);
+
+  // Blend all visible layers on a black background and write the result to
+  // the canvas at "x", "y".
+  void Render(Canvas *canvas, int x = 0, int y = 0);
+
+  // The width * height composed pixels of the last Render().
+  const Color *result() const { return result_.data(); }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+private:
+  LayerCompositor(const LayerCompositor&);  // No copy.
+
+  void Blend(const Layer &layer, Color *dest) const;
+
+  const int width_;
+  const int height_;
+  std::vector<Layer*> layers_;
+
+  // The bottom layers that did not change are kept blended in the cache.
+  std::vector<Color> cache_;
+  size_t cached_layers_;
+  bool cache_valid_;
+
+  std::vector<Color> result_;
+};
+}  // namespace rgb_matrix
+
+#endif  // RPI_LAYER_COMPOSITOR_H
@@ -44,6 +44,10 @@ struct LedFont;
  *
  * To get the defaults, non-set values have to be initialized to zero, so you
  * should zero out this struct before setting anything.
+ *
+ * New fields go to the end. The C# binding passes its own copy of this
+ * struct, bindings/c#/InternalRGBLedMatrixOptions.cs, which needs to be
+ * changed in the same commit.
  */
 struct RGBLedMatrixOptions {
   /*
@@ -158,6 +162,16 @@ struct RGBLedMatrixOptions {
    * processes when waiting and renders single core boards more responsive.
    */
   bool disable_busy_waiting;     /* Corresponding flag: --led-busy-waiting */
+
+  /* Realtime priority of the refresh thread, 1..99. 0: use default (99).
+   */
+  int refresh_priority;     /* Corresponding flag: --led-refresh-priority */
+
+  /* CPU to run the refresh thread on. 0: use default, which is an isolated
+   * CPU if there is one, otherwise the last CPU. So to choose CPU 0, which
+   * is rarely a good idea, use the command line flag.
+   */
+  int refresh_cpu;          /* Corresponding flag: --led-refresh-cpu */
 };
 
 /**
@@ -327,12 +341,51 @@ void led_canvas_set_pixel(struct LedCanvas *canvas, int x, int y,
 void led_canvas_set_pixels(struct LedCanvas *canvas, int x, int y,
                            int width, int height, struct Color *colors);
 
+/**
+ * Copies pixels to rectangle at (x, y) with size (width, height) from a
+ * buffer of rgb byte triplets, with rows "stride" bytes apart. So this can
+ * upload a whole frame, or a part of a larger image, in one call.
+ */
+void led_canvas_set_pixels_rgb(struct LedCanvas *canvas, int x, int y,
+                               int width, int height,
+                               const uint8_t *rgb, int stride);
+
 /** Clear screen (black). */
 void led_canvas_clear(struct LedCanvas *canvas);
 
 /** Fill matrix with given color. */
 void led_canvas_fill(struct LedCanvas *canvas, uint8_t r, uint8_t g, uint8_t b);
 
+/** Fill rectangle at (x, y) with size (width, height) with color (r,g,b). */
+void led_canvas_fill_rect(struct LedCanvas *canvas, int x, int y,
+                          int width, int height,
+                          uint8_t r, uint8_t g, uint8_t b);
+
+/** A horizontal run of "length" pixels of one color starting at (x, y). */
+struct LedSpan {
+  int x;
+  int y;
+  int length;
+  struct Color color;
+};
+
+/** Fill "count" spans, e.g. all the bars of a chart, in one call. */
+void led_canvas_fill_spans(struct LedCanvas *canvas,
+                           const struct LedSpan *spans, int count);
+
+/**
+ * Copy rectangle at (src_x, src_y) with size (width, height) of canvas
+ * "src" to (dst_x, dst_y) of "dst". Both need to be canvases of the same
+ * matrix, or the same canvas. This works on the internal representation, so
+ * it is much cheaper than setting the pixels again.
+ */
+void led_canvas_blit(struct LedCanvas *dst, const struct LedCanvas *src,
+                     int src_x, int src_y, int width, int height,
+                     int dst_x, int dst_y);
+
+/** Move content of canvas by (dx, dy) pixels; uncovered area becomes black. */
+void led_canvas_scroll(struct LedCanvas *canvas, int dx, int dy);
+
 /*** API to provide double-buffering. ***/
 
 /**
@@ -356,6 +409,15 @@ struct LedCanvas *led_matrix_create_offscreen_canvas(struct RGBLedMatrix *matrix
 struct LedCanvas *led_matrix_swap_on_vsync(struct RGBLedMatrix *matrix,
                                            struct LedCanvas *canvas);
 
+/**
+ * Upload a full frame to "canvas" like led_canvas_set_pixels_rgb(), then
+ * swap it like led_matrix_swap_on_vsync(). Returns the new offscreen canvas.
+ * Producing a frame elsewhere, this shows it with a single call.
+ */
+struct LedCanvas *led_matrix_swap_on_vsync_rgb(struct RGBLedMatrix *matrix,
+                                               struct LedCanvas *canvas,
+                                               const uint8_t *rgb, int stride);
+
 uint8_t led_matrix_get_brightness(struct RGBLedMatrix *matrix);
 void led_matrix_set_brightness(struct RGBLedMatrix *matrix, uint8_t brightness);
 
@@ -405,6 +467,22 @@ int vertical_draw_text(struct LedCanvas *c, struct LedFont *font, int x, int y,
                        uint8_t r, uint8_t g, uint8_t b,
                        const char *utf8_text, int kerning_offset);
 
+/* One text of a batch to be drawn with draw_texts(). */
+struct LedText {
+  struct LedFont *font;
+  int x;
+  int y;
+  struct Color color;
+  int kerning_offset;
+  int vertical;             /* If non-zero, draw like vertical_draw_text(). */
+  const char *utf8_text;
+};
+
+// Draw "count" texts in one call. If "advances" is not NULL, it receives the
+// values draw_text() or vertical_draw_text() would return for each text.
+void draw_texts(struct LedCanvas *c, const struct LedText *texts, int count,
+                int *advances);
+
 void draw_circle(struct LedCanvas *c, int x, int y, int radius,
                  uint8_t r, uint8_t g, uint8_t b);
 
@@ -34,6 +34,12 @@
 namespace rgb_matrix {
 class RGBMatrix;
 class FrameCanvas;   // Canvas for Double- and Multibuffering
+
+// A change of the GPIO input pins, see RGBMatrix::ReadInputEvents().
+struct GPIOInputEvent {
+  uint64_t timestamp_usec;  // When seen; CLOCK_MONOTONIC in microseconds.
+  uint64_t bits;            // All GPIO input pins after the change.
+};
 struct RuntimeOptions;
 
 // The RGB matrix provides the framebuffer and the facilities to constantly
@@ -159,6 +165,15 @@ public:
     // Sleep instead of busy wait to free CPU cycles but get slightly less
     // accurate frame timing.
     bool disable_busy_waiting;   // Flag: --led-busy-waiting
+
+    // Realtime priority of the refresh thread. 1..99, 0 for no realtime
+    // scheduling. Default: 99
+    int refresh_priority;        // Flag: --led-refresh-priority
+
+    // CPU the refresh thread runs on. -1 chooses automatically: a CPU
+    // isolated with isolcpus= if there is one, otherwise the last CPU.
+    // All other threads of the program are kept off that CPU.
+    int refresh_cpu;             // Flag: --led-refresh-cpu
   };
 
   // Factory to create a matrix. Additional functionality includes dropping
@@ -201,6 +216,10 @@ public:
   virtual int height() const;
   virtual void SetPixel(int x, int y,
                         uint8_t red, uint8_t green, uint8_t blue);
+  virtual void SetPixels(int x, int y, int width, int height,
+                         const Color *colors);
+  virtual void FillRect(int x, int y, int width, int height,
+                        uint8_t red, uint8_t green, uint8_t blue);
   virtual void Clear();
   virtual void Fill(uint8_t red, uint8_t green, uint8_t blue);
 
@@ -302,6 +321,17 @@ public:
   // Returns the bitmap of all GPIO input pins.
   uint64_t AwaitInputChange(int timeout_ms);
 
+  // Non-blocking alternative to AwaitInputChange(), that does not miss
+  // short changes such as quick button presses between calls.
+  //
+  // Copies up to "max_events" input changes recorded by the refresh thread
+  // since the last call into "events", oldest first. Returns the number of
+  // events copied. About 256 events are kept; if they are not read in time,
+  // newer changes are dropped.
+  //
+  // Only one thread should read the events.
+  int ReadInputEvents(GPIOInputEvent *events, int max_events);
+
   // Request user writable GPIO bits.
   // This allows to request a bitmap of GPIO-bits to be used by the user for
   // writing.
@@ -335,6 +365,7 @@ private:
 
 namespace internal {
 class Framebuffer;
+class PixelDesignatorMap;
 }
 
 class FrameCanvas : public Canvas {
@@ -377,18 +408,33 @@ public:
   // Copy content from other FrameCanvas owned by the same RGBMatrix.
   void CopyFrom(const FrameCanvas &other);
 
+  // Copy the "width" x "height" rectangle at "src_x", "src_y" of another
+  // FrameCanvas owned by the same RGBMatrix (or this one) to "dst_x",
+  // "dst_y". This works directly on the internal representation, so it is
+  // much cheaper than setting the pixels again; e.g. to move sprites or
+  // to scroll by copying the frame that was shown last.
+  void Blit(const FrameCanvas &src, int src_x, int src_y,
+            int width, int height, int dst_x, int dst_y);
+
+  // Move the content of this canvas by "dx", "dy" pixels. The uncovered
+  // area becomes black.
+  void ScrollBy(int dx, int dy);
+
   // -- Canvas interface.
   virtual int width() const;
   virtual int height() const;
   virtual void SetPixel(int x, int y,
                         uint8_t red, uint8_t green, uint8_t blue);
   virtual void SetPixels(int x, int y, int width, int height,
-                         Color *colors);
+                         const Color *colors);
+  virtual void FillRect(int x, int y, int width, int height,
+                        uint8_t red, uint8_t green, uint8_t blue);
   virtual void Clear();
   virtual void Fill(uint8_t red, uint8_t green, uint8_t blue);
 
 private:
   friend class RGBMatrix;
+  friend class FrameCanvasFactory;
 
   FrameCanvas(internal::Framebuffer *frame) : frame_(frame){}
   virtual ~FrameCanvas();   // Any FrameCanvas is owned by RGBMatrix.
@@ -397,6 +443,59 @@ private:
   internal::Framebuffer *const frame_;
 };
 
+// Creates FrameCanvases for the geometry and pixel mapping of the given
+// Options, without an RGBMatrix: no GPIO access, no root, no refresh thread,
+// so this works on any machine. Use it to render offline, e.g. to create
+// streams with StreamWriter that are played on the matrix later; these then
+// need to be created with the same Options as the matrix.
+//
+// The canvases can be used with each other like the ones of an RGBMatrix
+// (CopyFrom(), Blit()). They are owned by the factory and deleted with it.
+class FrameCanvasFactory {
+public:
+  // Returns NULL, if the options are invalid (a message then is written to
+  // stderr). The runtime options are not needed; they only concern the
+  // hardware.
+  static FrameCanvasFactory *Create(const RGBMatrix::Options &options);
+
+  ~FrameCanvasFactory();
+
+  // Create a new canvas, with the PWM bits, brightness and luminance
+  // correction currently set.
+  FrameCanvas *CreateFrameCanvas();
+
+  // Apply another pixel mapper, see RGBMatrix::ApplyPixelMapper(). The ones
+  // given in the options are already applied.
+  bool ApplyPixelMapper(const PixelMapper *mapper);
+
+  // Size of the canvases with all pixel mappers applied.
+  int width() const;
+  int height() const;
+
+  // Settings for canvases created from now on; SetBrightness() also
+  // changes the existing ones.
+  void SetPWMBits(uint8_t value) { options_.pwm_bits = value; }
+  void set_luminance_correct(bool on) { luminance_correct_ = on; }
+  void SetBrightness(uint8_t brightness);
+
+private:
+  friend class RGBMatrix;
+
+  explicit FrameCanvasFactory(const RGBMatrix::Options &options);
+
+  // Apply pixel mappers that have been passed down via a configuration
+  // string.
+  void ApplyNamedPixelMappers(const char *pixel_mapper_config,
+                              int chain, int parallel);
+
+  // The options, with rows and cols as the multiplexer needs them.
+  RGBMatrix::Options options_;
+  bool luminance_correct_;
+  std::vector<FrameCanvas*> created_frames_;
+  FrameCanvas *unused_frame_;  // Created to set up the mapping, not handed out yet.
+  internal::PixelDesignatorMap *shared_pixel_mapper_;
+};
+
 // Runtime options to simplify doing common things for many programs such as
 // dropping privileges and becoming a daemon.
 struct RuntimeOptions {
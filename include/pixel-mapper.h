@@ -105,6 +105,19 @@ std::vector<std::string> GetAvailablePixelMappers();
 const PixelMapper *FindPixelMapper(const char *name,
                                    int chain, int parallel,
                                    const char *parameter = NULL);
+
+// Write a file for the "File" pixel mapper that does the same as the
+// semicolon-separated list of pixel mappers in "pixel_mapper_config" (same
+// syntax as --led-pixel-mapper). "matrix_width" and "matrix_height" is the
+// size of the matrix before any of these mappers are applied, i.e. just with
+// multiplexing.
+// Then, --led-pixel-mapper="File:<filename>" gives the same result, but
+// only needs a table lookup per pixel when the matrix is created.
+// Returns 'true' on success.
+bool WritePixelMapperFile(const char *filename,
+                          const char *pixel_mapper_config,
+                          int chain, int parallel,
+                          int matrix_width, int matrix_height);
 }  // namespace rgb_matrix
 
 #endif  // RGBMATRIX_PIXEL_MAPPER
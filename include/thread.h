@@ -81,6 +81,15 @@ private:
   Mutex *const mutex_;
 };
 
+// Bitmask of the CPUs that are isolated from the regular scheduling with
+// the isolcpus= kernel parameter. 0 if there are none.
+uint32_t GetIsolatedCPUs();
+
+// Keep all threads of this process off the given CPU, e.g. because the
+// matrix refresh runs there. Threads started later inherit this.
+// Threads that are explicitly bound to only that CPU are not changed.
+void KeepThreadsOffCPU(int cpu);
+
 }  // end namespace rgb_matrix
 
 #endif  // RPI_THREAD_H
@@ -38,13 +38,45 @@ namespace rgb_matrix {
 static constexpr int kMaxFontWidth = 196;
 typedef std::bitset<kMaxFontWidth> rowbitmap_t;
 
+// A horizontal run of pixels within a glyph.
+struct GlyphSpan {
+  int16_t x, y;
+  int16_t length;
+};
+
 struct Font::Glyph {
   int device_width, device_height;
   int width, height;
   int x_offset, y_offset;
   std::vector<rowbitmap_t> bitmap;  // contains 'height' elements.
+
+  // Pre-computed from the bitmap, so that drawing can fill whole runs of
+  // pixels instead of testing each bit.
+  std::vector<GlyphSpan> foreground;
+  std::vector<GlyphSpan> background;
+
+  void ComputeSpans();
 };
 
+void Font::Glyph::ComputeSpans() {
+  foreground.clear();
+  background.clear();
+  for (int y = 0; y < height; ++y) {
+    const rowbitmap_t &row = bitmap[y];
+    int x = 0;
+    while (x < device_width) {
+      const bool is_set = row.test(kMaxFontWidth - 1 - x);
+      GlyphSpan span;
+      span.x = x;
+      span.y = y;
+      while (x < device_width && row.test(kMaxFontWidth - 1 - x) == is_set)
+        ++x;
+      span.length = x - span.x;
+      (is_set ? foreground : background).push_back(span);
+    }
+  }
+}
+
 static bool readNibble(char c, uint8_t* val) {
   if (c >= '0' && c <= '9') { *val = c - '0'; return true; }
   if (c >= 'a' && c <= 'f') { *val = c - 'a' + 0xa; return true; }
@@ -66,7 +98,9 @@ static bool parseBitmap(const char *buffer, rowbitmap_t* result) {
   return true;
 }
 
-Font::Font() : font_height_(-1), base_line_(0) {}
+Font::Font() : font_height_(-1), base_line_(0) {
+  std::fill(latin1_glyphs_, latin1_glyphs_ + 256, (const Glyph*)NULL);
+}
 Font::~Font() {
   for (CodepointGlyphMap::iterator it = glyphs_.begin();
        it != glyphs_.end(); ++it) {
@@ -118,6 +152,7 @@ bool Font::LoadFont(const char *path) {
     }
     else if (strncmp(buffer, "ENDCHAR", strlen("ENDCHAR")) == 0) {
       if (current_glyph && row == current_glyph->height) {
+        current_glyph->ComputeSpans();
         delete glyphs_[codepoint];  // just in case there was one.
         glyphs_[codepoint] = current_glyph;
         current_glyph = NULL;
@@ -125,9 +160,17 @@ bool Font::LoadFont(const char *path) {
     }
   }
   fclose(f);
+  UpdateLatin1Lookup();
   return true;
 }
 
+void Font::UpdateLatin1Lookup() {
+  for (uint32_t cp = 0; cp < 256; ++cp) {
+    CodepointGlyphMap::const_iterator found = glyphs_.find(cp);
+    latin1_glyphs_[cp] = (found == glyphs_.end()) ? NULL : found->second;
+  }
+}
+
 Font *Font::CreateOutlineFont() const {
   Font *r = new Font();
   const int kBorder = 1;
@@ -164,12 +207,16 @@ Font *Font::CreateOutlineFont() const {
       rowbitmap_t orig_bitmap = orig->bitmap[h] >> kBorder;
       tmp_glyph->bitmap[h+kBorder] &= ~orig_bitmap;
     }
+    tmp_glyph->ComputeSpans();
     r->glyphs_[it->first] = tmp_glyph;
   }
+  r->UpdateLatin1Lookup();
   return r;
 }
 
 const Font::Glyph *Font::FindGlyph(uint32_t unicode_codepoint) const {
+  if (unicode_codepoint < 256)
+    return latin1_glyphs_[unicode_codepoint];
   CodepointGlyphMap::const_iterator found = glyphs_.find(unicode_codepoint);
   if (found == glyphs_.end())
     return NULL;
@@ -194,14 +241,16 @@ int Font::DrawGlyph(Canvas *c, int x_pos, int y_pos,
     return g->device_width;  // Outside canvas border. Bail out early.
   }
 
-  for (int y = 0; y < g->height; ++y) {
-    const rowbitmap_t& row = g->bitmap[y];
-    for (int x = 0; x < g->device_width; ++x) {
-      if (row.test(kMaxFontWidth - 1 - x)) {
-        c->SetPixel(x_pos + x, y_pos + y, color.r, color.g, color.b);
-      } else if (bgcolor) {
-        c->SetPixel(x_pos + x, y_pos + y, bgcolor->r, bgcolor->g, bgcolor->b);
-      }
+  for (size_t i = 0; i < g->foreground.size(); ++i) {
+    const GlyphSpan &s = g->foreground[i];
+    c->FillRect(x_pos + s.x, y_pos + s.y, s.length, 1,
+                color.r, color.g, color.b);
+  }
+  if (bgcolor) {
+    for (size_t i = 0; i < g->background.size(); ++i) {
+      const GlyphSpan &s = g->background[i];
+      c->FillRect(x_pos + s.x, y_pos + s.y, s.length, 1,
+                  bgcolor->r, bgcolor->g, bgcolor->b);
     }
   }
   return g->device_width;
@@ -11,6 +11,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <time.h>
 
 #include <algorithm>
 
@@ -21,12 +22,12 @@ namespace rgb_matrix {
 // Pre-c++11 helper
 #define STATIC_ASSERT(msg, c) typedef int static_assert_##msg[(c) ? 1 : -1]
 
-namespace {
 // We write magic values as integers to automatically detect endian issues.
 // Streams are stored in little-endian. This is the ARM default (running
 // the Raspberry Pi, but also x86; so it is possible to create streams easily
 // on a different x86 Linux PC.
 static const uint32_t kFileMagicValue = 0xED0C5A48;
+namespace {
 struct FileHeader {
   uint32_t magic;  // kFileMagicValue
   uint32_t buf_size;
@@ -34,20 +35,66 @@ struct FileHeader {
   uint32_t height;
   uint64_t future_use1;
   uint64_t is_wide_gpio : 1;
-  uint64_t flags_future_use : 63;
+  uint64_t has_timestamps : 1;  // FrameHeader::presentation_time_us valid.
+  uint64_t is_rgb : 1;          // Frames are width * height RGB24 pixels.
+  uint64_t flags_future_use : 61;
 };
+}
 STATIC_ASSERT(file_header_size_changed, sizeof(FileHeader) == 32);
 
+namespace {
+
 static const uint32_t kFrameMagicValue = 0x12345678;
 struct FrameHeader {
   uint32_t magic;  // kFrameMagic
   uint32_t size;
   uint32_t hold_time_us;  // How long this frame lasts in usec.
   uint32_t future_use1;
+  uint64_t presentation_time_us;  // Was future_use2, so 0 in old streams.
+  uint64_t future_use3;
+};
+STATIC_ASSERT(frame_header_size_changed, sizeof(FrameHeader) == 32);
+
+// Non-frame data. Same size as the FrameHeader, so that the reader can read
+// the next header without knowing what comes.
+static const uint32_t kDataMagicValue = 0x44415441;
+struct DataHeader {
+  uint32_t magic;  // kDataMagicValue
+  uint32_t size;   // Size of the payload following.
+  uint32_t type;   // StreamDataChunk::Type
+  uint32_t sample_rate;
+  uint64_t presentation_time_us;
+  uint32_t channels;
+  uint32_t future_use1;
+};
+STATIC_ASSERT(data_header_size_changed,
+              sizeof(DataHeader) == sizeof(FrameHeader));
+
+// Start of a named segment. Followed by the name.
+static const uint32_t kSegmentMagicValue = 0x5345474D;
+struct SegmentHeader {
+  uint32_t magic;  // kSegmentMagicValue
+  uint32_t size;   // Length of the name following.
+  int32_t loops;   // Negative: forever.
+  uint32_t future_use1;
   uint64_t future_use2;
   uint64_t future_use3;
 };
-STATIC_ASSERT(file_header_size_changed, sizeof(FrameHeader) == 32);
+STATIC_ASSERT(segment_header_size_changed,
+              sizeof(SegmentHeader) == sizeof(FrameHeader));
+
+// All headers following the FileHeader have the same size, so we can read
+// them before knowing what they are. A FileHeader can show up in the middle
+// if streams are concatenated, so it has the same size as well.
+union ChunkHeader {
+  uint32_t magic;
+  FileHeader file;
+  FrameHeader frame;
+  DataHeader data;
+  SegmentHeader segment;
+};
+STATIC_ASSERT(chunk_header_size_changed,
+              sizeof(ChunkHeader) == sizeof(FileHeader));
 }
 
 FileStreamIO::FileStreamIO(int fd) : fd_(fd) {
@@ -65,6 +112,11 @@ ssize_t FileStreamIO::Append(const void *buf, const size_t count) {
   return write(fd_, buf, count);
 }
 
+int64_t FileStreamIO::Tell() { return lseek(fd_, 0, SEEK_CUR); }
+bool FileStreamIO::Seek(int64_t pos) {
+  return lseek(fd_, pos, SEEK_SET) == pos;
+}
+
 void MemStreamIO::Rewind() { pos_ = 0; }
 ssize_t MemStreamIO::Read(void *buf, size_t count) {
   const size_t amount = std::min(count, buffer_.size() - pos_);
@@ -76,6 +128,11 @@ ssize_t MemStreamIO::Append(const void *buf, size_t count) {
   buffer_.append((const char*)buf, count);
   return count;
 }
+bool MemStreamIO::Seek(int64_t pos) {
+  if (pos < 0 || pos > (int64_t)buffer_.size()) return false;
+  pos_ = pos;
+  return true;
+}
 
 MemMapViewInput::MemMapViewInput(int fd) : buffer_(nullptr) {
   struct stat s;
@@ -101,10 +158,16 @@ MemMapViewInput::MemMapViewInput(int fd) : buffer_(nullptr) {
 
 void MemMapViewInput::Rewind() { pos_ = buffer_; }
 ssize_t MemMapViewInput::Read(void *buf, size_t count) {
-  if (pos_ + count >= end_) return -1;
-  memcpy(buf, pos_, count);
-  pos_ += count;
-  return count;
+  const size_t amount = std::min(count, (size_t)(end_ - pos_));
+  memcpy(buf, pos_, amount);
+  pos_ += amount;
+  return amount;
+}
+
+bool MemMapViewInput::Seek(int64_t pos) {
+  if (pos < 0 || pos > end_ - buffer_) return false;
+  pos_ = buffer_ + pos;
+  return true;
 }
 
 MemMapViewInput::~MemMapViewInput() {
@@ -112,16 +175,21 @@ MemMapViewInput::~MemMapViewInput() {
 }
 
 // Read exactly count bytes including retries. Returns success.
-static bool FullRead(StreamIO *io, void *buf, const size_t count) {
+// Read up to count bytes, less only at EOF. Returns bytes read or -1.
+static ssize_t ReadUpTo(StreamIO *io, void *buf, const size_t count) {
   int remaining = count;
   char *char_buffer = (char*)buf;
   while (remaining > 0) {
     int r = io->Read(char_buffer, remaining);
-    if (r < 0) return false;
+    if (r < 0) return -1;
     if (r == 0) break;  // EOF.
     char_buffer += r; remaining -= r;
   }
-  return remaining == 0;
+  return count - remaining;
+}
+
+static bool FullRead(StreamIO *io, void *buf, const size_t count) {
+  return ReadUpTo(io, buf, count) == (ssize_t)count;
 }
 
 // Write exactly count bytes including retries. Returns success.
@@ -136,104 +204,510 @@ static bool FullAppend(StreamIO *io, const void *buf, const size_t count) {
   return remaining == 0;
 }
 
-StreamWriter::StreamWriter(StreamIO *io) : io_(io), header_written_(false) {}
+StreamWriter::StreamWriter(StreamIO *io)
+  : io_(io), header_written_(false), is_rgb_(false),
+    next_presentation_time_us_(0) {}
+
 bool StreamWriter::Stream(const FrameCanvas &frame, uint32_t hold_time_us) {
+  return Stream(frame, hold_time_us, next_presentation_time_us_);
+}
+
+bool StreamWriter::Stream(const FrameCanvas &frame, uint32_t hold_time_us,
+                          uint64_t presentation_time_us) {
   const char *data;
   size_t len;
   frame.Serialize(&data, &len);
 
   if (!header_written_) {
-    WriteFileHeader(frame, len);
+    WriteFileHeader(frame.width(), frame.height(), len, false);
+  }
+  if (is_rgb_) return false;
+  return WriteFrame(data, len, hold_time_us, presentation_time_us);
+}
+
+bool StreamWriter::StreamRGB(const Color *pixels, int width, int height,
+                             uint32_t hold_time_us) {
+  return StreamRGB(pixels, width, height, hold_time_us,
+                   next_presentation_time_us_);
+}
+
+bool StreamWriter::StreamRGB(const Color *pixels, int width, int height,
+                             uint32_t hold_time_us,
+                             uint64_t presentation_time_us) {
+  const size_t len = width * height * sizeof(Color);
+  if (!header_written_) {
+    WriteFileHeader(width, height, len, true);
   }
+  if (!is_rgb_) return false;
+  return WriteFrame(pixels, len, hold_time_us, presentation_time_us);
+}
+
+bool StreamWriter::WriteFrame(const void *data, size_t len,
+                              uint32_t hold_time_us,
+                              uint64_t presentation_time_us) {
   FrameHeader h = {};
   h.magic = kFrameMagicValue;
   h.size = len;
   h.hold_time_us = hold_time_us;
-  FullAppend(io_, &h, sizeof(h));
-  return FullAppend(io_, data, len) == (ssize_t)len;
+  h.presentation_time_us = presentation_time_us;
+  next_presentation_time_us_ = presentation_time_us + hold_time_us;
+  return (WritePendingSegment()
+          && FullAppend(io_, &h, sizeof(h)) && FullAppend(io_, data, len));
 }
 
-void StreamWriter::WriteFileHeader(const FrameCanvas &frame, size_t len) {
+bool StreamWriter::BeginSegment(const std::string &name, int loops) {
+  SegmentHeader h = {};
+  h.magic = kSegmentMagicValue;
+  h.size = name.size();
+  h.loops = loops;
+  // Replaces a previous segment that didn't get any frames, e.g. because
+  // its file could not be loaded.
+  pending_segment_.assign((const char*)&h, sizeof(h));
+  pending_segment_.append(name);
+  return true;
+}
+
+// Write the header of the segment that just got its first content.
+bool StreamWriter::WritePendingSegment() {
+  if (pending_segment_.empty()) return true;
+  std::string segment;
+  segment.swap(pending_segment_);
+  if (!header_written_) {
+    pending_data_.append(segment);
+    return true;
+  }
+  return FullAppend(io_, segment.data(), segment.size());
+}
+
+bool StreamWriter::StreamData(const StreamDataChunk &chunk) {
+  DataHeader h = {};
+  h.magic = kDataMagicValue;
+  h.size = chunk.size;
+  h.type = chunk.type;
+  h.sample_rate = chunk.sample_rate;
+  h.channels = chunk.channels;
+  h.presentation_time_us = chunk.presentation_time_us;
+
+  if (!WritePendingSegment()) return false;
+
+  // We only know the frame size once we see the first frame, so keep the
+  // data until the file header is written.
+  if (!header_written_) {
+    pending_data_.append((const char*)&h, sizeof(h));
+    pending_data_.append((const char*)chunk.data, chunk.size);
+    return true;
+  }
+  return (FullAppend(io_, &h, sizeof(h))
+          && FullAppend(io_, chunk.data, chunk.size));
+}
+
+void StreamWriter::WriteFileHeader(int width, int height, size_t len,
+                                   bool is_rgb) {
   FileHeader header = {};
   header.magic = kFileMagicValue;
-  header.width = frame.width();
-  header.height = frame.height();
+  header.width = width;
+  header.height = height;
   header.buf_size = len;
-  header.is_wide_gpio = (sizeof(gpio_bits_t) > 4);
+  header.is_wide_gpio = !is_rgb && (sizeof(gpio_bits_t) > 4);
+  header.has_timestamps = 1;
+  header.is_rgb = is_rgb;
+  is_rgb_ = is_rgb;
   FullAppend(io_, &header, sizeof(header));
   header_written_ = true;
+  if (!pending_data_.empty()) {
+    FullAppend(io_, pending_data_.data(), pending_data_.size());
+    pending_data_.clear();
+  }
+}
+
+// Returns if a stream with this header can be played on "frame".
+static bool CheckFileHeader(const FileHeader &header, const Canvas &frame) {
+  if (header.magic != kFileMagicValue) return false;
+  if (header.is_rgb) {
+    // Portable frames are mapped to whatever canvas we play on. If the
+    // sizes don't match, they are clipped or padded with black.
+    return header.buf_size == header.width * header.height * sizeof(Color);
+  }
+  if ((int)header.width != frame.width()
+      || (int)header.height != frame.height()) {
+    fprintf(stderr, "This stream is for %dx%d, can't play on %dx%d. "
+            "Please use the same settings for record/replay\n",
+            header.width, header.height, frame.width(), frame.height());
+    return false;
+  }
+  if (header.is_wide_gpio != (sizeof(gpio_bits_t) == 8)) {
+    fprintf(stderr, "This stream was written with %s GPIO width support but "
+            "this library is compiled with %d bit GPIO width (see "
+            "ENABLE_WIDE_GPIO_COMPUTE_MODULE setting in lib/Makefile)\n",
+            header.is_wide_gpio ? "wide (64-bit)" : "narrow (32-bit)",
+            int(sizeof(gpio_bits_t) * 8));
+    return false;
+  }
+  return true;
 }
 
 StreamReader::StreamReader(StreamIO *io)
-  : io_(io), state_(STREAM_AT_BEGIN), header_frame_buffer_(NULL) {
+  : io_(io), state_(STREAM_AT_BEGIN), is_rgb_(false),
+    rgb_width_(0), rgb_height_(0), has_timestamps_(false),
+    presentation_time_us_(0), next_derived_time_us_(0), listener_(NULL),
+    loop_segments_(true), segment_loops_left_(1), segment_start_(-1),
+    segment_has_frames_(false), time_discontinuity_(true), time_offset_us_(0),
+    has_pending_seek_(false), frame_buffer_(NULL) {
   io_->Rewind();
 }
-StreamReader::~StreamReader() { delete [] header_frame_buffer_; }
+StreamReader::~StreamReader() { delete [] frame_buffer_; }
 
 void StreamReader::Rewind() {
   io_->Rewind();
   state_ = STREAM_AT_BEGIN;
+  has_pending_seek_ = false;
 }
 
-bool StreamReader::GetNext(FrameCanvas *frame, uint32_t* hold_time_us) {
-  if (state_ == STREAM_AT_BEGIN && !ReadFileHeader(*frame)) return false;
-  if (state_ != STREAM_READING) return false;
+void StreamReader::StartSegment(const std::string &name, int loops) {
+  segment_name_ = name;
+  segment_loops_left_ = loops;
+  segment_start_ = io_->Tell();
+  segment_has_frames_ = false;
+  if (listener_) listener_->OnStreamSegment(name, loops);
+}
 
-  // Read header and expected buffer size.
-  if (!FullRead(io_, header_frame_buffer_,
-                sizeof(FrameHeader) + frame_buf_size_)) {
+// Called at the end of a segment. Returns true if we jumped back to its
+// beginning to play it again.
+bool StreamReader::RepeatSegment() {
+  if (!loop_segments_ || !segment_has_frames_ || segment_loops_left_ == 1
+      || segment_loops_left_ == 0 || segment_start_ < 0
+      || !io_->Seek(segment_start_)) {
     return false;
   }
+  if (segment_loops_left_ > 0) --segment_loops_left_;
+  segment_has_frames_ = false;
+  time_discontinuity_ = true;
+  return true;
+}
 
-  const FrameHeader &h = *reinterpret_cast<FrameHeader*>(header_frame_buffer_);
+// Map timestamps found in the stream to a timeline that continues to
+// increase across loops and concatenated streams.
+uint64_t StreamReader::AdjustTime(uint64_t presentation_time_us) {
+  if (time_discontinuity_) {
+    time_offset_us_ = next_derived_time_us_ - presentation_time_us;
+    time_discontinuity_ = false;
+  }
+  return presentation_time_us + time_offset_us_;
+}
 
-  // TODO: we might allow for this to be a kFileMagicValue, to allow people
-  // to just concatenate streams. In that case, we just would need to read
-  // ahead past this header (both headers are designed to be same size)
-  if (h.magic != kFrameMagicValue) {
-    state_ = STREAM_ERROR;
-    return false;
+bool StreamReader::ReadFrame(const Canvas &frame, uint32_t* hold_time_us) {
+  if (state_ == STREAM_AT_BEGIN && !ReadFileHeader(frame)) return false;
+  if (state_ != STREAM_READING) return false;
+
+  if (has_pending_seek_) {
+    // The segment might belong to a different stream that was concatenated,
+    // so go through its file header first.
+    has_pending_seek_ = false;
+    FileHeader file_header;
+    if (!io_->Seek(pending_seek_.file_header_offset)
+        || !FullRead(io_, &file_header, sizeof(file_header))
+        || !CheckFileHeader(file_header, frame)
+        || !io_->Seek(pending_seek_.offset)) {
+      state_ = STREAM_ERROR;
+      return false;
+    }
+    SetFormat(file_header.is_rgb, file_header.width, file_header.height,
+              file_header.has_timestamps, file_header.buf_size);
+    StartSegment(pending_seek_.name, pending_seek_.loops);
+    time_discontinuity_ = true;
+  }
+
+  // All headers have the same size, so we read the header first, then
+  // decide what to do with the payload.
+  ChunkHeader header;
+  for (;;) {
+    const ssize_t header_bytes = ReadUpTo(io_, &header, sizeof(header));
+    if (header_bytes != sizeof(header)) {
+      if (header_bytes != 0) {  // Truncated, not at the end of the stream.
+        state_ = STREAM_ERROR;
+        return false;
+      }
+      if (RepeatSegment()) continue;
+      return false;
+    }
+
+    switch (header.magic) {
+    case kFrameMagicValue:
+      break;
+
+    case kDataMagicValue: {
+      const DataHeader &d = header.data;
+      data_buffer_.resize(d.size);
+      if (!FullRead(io_, &data_buffer_[0], d.size)) {
+        state_ = STREAM_ERROR;
+        return false;
+      }
+      if (listener_) {
+        StreamDataChunk chunk;
+        chunk.type = d.type;
+        chunk.sample_rate = d.sample_rate;
+        chunk.channels = d.channels;
+        chunk.presentation_time_us = AdjustTime(d.presentation_time_us);
+        chunk.data = data_buffer_.data();
+        chunk.size = d.size;
+        listener_->OnStreamData(chunk);
+      }
+      continue;
+    }
+
+    case kSegmentMagicValue:
+    case kFileMagicValue:
+      // End of the current segment. Jump back if it is to be repeated,
+      // otherwise the next one starts here.
+      if (RepeatSegment()) continue;
+      if (header.magic == kFileMagicValue) {
+        // Concatenated stream.
+        const FileHeader &f = header.file;
+        if (!CheckFileHeader(f, frame)) {
+          state_ = STREAM_ERROR;
+          return false;
+        }
+        SetFormat(f.is_rgb, f.width, f.height, f.has_timestamps, f.buf_size);
+        StartSegment("", 1);
+        time_discontinuity_ = true;
+      } else {
+        std::string name(header.segment.size, '\0');
+        if (!FullRead(io_, &name[0], name.size())) {
+          state_ = STREAM_ERROR;
+          return false;
+        }
+        StartSegment(name, header.segment.loops);
+      }
+      continue;
+
+    default:
+      state_ = STREAM_ERROR;
+      return false;
+    }
+    break;
   }
 
-  // In the future, we might allow larger buffers (audio?), but never smaller.
-  // For now, we need to make sure to exactly match the size, as our assumption
-  // above is that we can read the full header + frame in one FullRead().
-  if (h.size != frame_buf_size_)
+  const FrameHeader &h = header.frame;
+
+  // In the future, we might allow larger buffers, but never smaller.
+  if (h.size != frame_buf_size_
+      || !FullRead(io_, frame_buffer_, frame_buf_size_)) {
+    state_ = STREAM_ERROR;
     return false;
+  }
 
+  segment_has_frames_ = true;
+  presentation_time_us_ = (has_timestamps_
+                           ? AdjustTime(h.presentation_time_us)
+                           : next_derived_time_us_);
+  next_derived_time_us_ = presentation_time_us_ + h.hold_time_us;
   if (hold_time_us) *hold_time_us = h.hold_time_us;
-  return frame->Deserialize(header_frame_buffer_ + sizeof(FrameHeader),
-                            frame_buf_size_);
+  return true;
 }
 
-bool StreamReader::ReadFileHeader(const FrameCanvas &frame) {
-  FileHeader header;
-  FullRead(io_, &header, sizeof(header));
-  if (header.magic != kFileMagicValue) {
-    state_ = STREAM_ERROR;
-    return false;
+void StreamReader::CopyRGBFrame(Canvas *canvas) const {
+  if (rgb_width_ < canvas->width() || rgb_height_ < canvas->height())
+    canvas->Clear();
+  canvas->SetPixels(0, 0, rgb_width_, rgb_height_,
+                    reinterpret_cast<const Color*>(frame_buffer_));
+}
+
+bool StreamReader::GetNext(FrameCanvas *frame, uint32_t* hold_time_us) {
+  if (!ReadFrame(*frame, hold_time_us)) return false;
+  if (is_rgb_) {
+    CopyRGBFrame(frame);
+    return true;
   }
-  if ((int)header.width != frame.width()
-      || (int)header.height != frame.height()) {
-    fprintf(stderr, "This stream is for %dx%d, can't play on %dx%d. "
-            "Please use the same settings for record/replay\n",
-            header.width, header.height, frame.width(), frame.height());
+  return frame->Deserialize(frame_buffer_, frame_buf_size_);
+}
+
+bool StreamReader::GetNextRGB(Canvas *canvas, uint32_t* hold_time_us) {
+  if (!ReadFrame(*canvas, hold_time_us)) return false;
+  if (!is_rgb_) {
+    fprintf(stderr, "Not a portable stream; can only play on a FrameCanvas\n");
     state_ = STREAM_ERROR;
     return false;
   }
-  if (header.is_wide_gpio != (sizeof(gpio_bits_t) == 8)) {
-    fprintf(stderr, "This stream was written with %s GPIO width support but "
-            "this library is compiled with %d bit GPIO width (see "
-            "ENABLE_WIDE_GPIO_COMPUTE_MODULE setting in lib/Makefile)\n",
-            header.is_wide_gpio ? "wide (64-bit)" : "narrow (32-bit)",
-            int(sizeof(gpio_bits_t) * 8));
+  CopyRGBFrame(canvas);
+  return true;
+}
+
+bool StreamReader::ReadFileHeader(const Canvas &frame) {
+  FileHeader header;
+  if (!FullRead(io_, &header, sizeof(header))
+      || !CheckFileHeader(header, frame)) {
     state_ = STREAM_ERROR;
     return false;
   }
+  SetFormat(header.is_rgb, header.width, header.height,
+            header.has_timestamps, header.buf_size);
+  next_derived_time_us_ = 0;
+  time_offset_us_ = 0;
+  time_discontinuity_ = true;
+  StartSegment("", 1);
+  return true;
+}
+
+void StreamReader::SetFormat(bool is_rgb, int width, int height,
+                             bool has_timestamps, size_t buf_size) {
   state_ = STREAM_READING;
-  frame_buf_size_ = header.buf_size;
-  if (!header_frame_buffer_)
-    header_frame_buffer_ = new char [ sizeof(FrameHeader) + header.buf_size ];
+  is_rgb_ = is_rgb;
+  rgb_width_ = width;
+  rgb_height_ = height;
+  has_timestamps_ = has_timestamps;
+  if (frame_buffer_ && buf_size != frame_buf_size_) {
+    delete [] frame_buffer_;
+    frame_buffer_ = NULL;
+  }
+  frame_buf_size_ = buf_size;
+  if (!frame_buffer_)
+    frame_buffer_ = new char [ buf_size ];
+}
+
+// Skip "count" bytes of payload.
+static bool Skip(StreamIO *io, size_t count) {
+  return io->Seek(io->Tell() + count);
+}
+
+bool StreamReader::BuildIndex(std::vector<StreamSegment> *index) {
+  io_->Rewind();
+  state_ = STREAM_AT_BEGIN;
+  if (io_->Tell() < 0) return false;
+
+  index->clear();
+  ChunkHeader header;
+  int64_t file_header_offset = 0;
+  StreamSegment *current = NULL;
+  for (;;) {
+    const int64_t pos = io_->Tell();
+    if (!FullRead(io_, &header, sizeof(header)))
+      break;
+    switch (header.magic) {
+    case kFileMagicValue:
+      file_header_offset = pos;
+      current = NULL;  // Unnamed segment if frames follow.
+      break;
+
+    case kSegmentMagicValue: {
+      StreamSegment segment;
+      segment.name.resize(header.segment.size);
+      if (!FullRead(io_, &segment.name[0], segment.name.size())) {
+        io_->Rewind();
+        return false;
+      }
+      segment.loops = header.segment.loops;
+      segment.frames = 0;
+      segment.duration_us = 0;
+      segment.file_header_offset = file_header_offset;
+      segment.offset = io_->Tell();
+      index->push_back(segment);
+      current = &index->back();
+      break;
+    }
+
+    case kFrameMagicValue:
+      if (!current) {
+        StreamSegment segment;
+        segment.loops = 1;
+        segment.frames = 0;
+        segment.duration_us = 0;
+        segment.file_header_offset = file_header_offset;
+        segment.offset = pos;
+        index->push_back(segment);
+        current = &index->back();
+      }
+      current->frames++;
+      current->duration_us += header.frame.hold_time_us;
+      // fallthrough
+    case kDataMagicValue:
+      if (!Skip(io_, header.frame.size)) {
+        io_->Rewind();
+        return false;
+      }
+      break;
+
+    default:
+      io_->Rewind();
+      return false;
+    }
+  }
+  io_->Rewind();
   return true;
 }
+
+void StreamReader::SeekToSegment(const StreamSegment &segment) {
+  pending_seek_ = segment;
+  has_pending_seek_ = true;
+}
+
+namespace {
+// Forwards data chunks and segments while transcoding.
+class DataForwarder : public StreamDataListener {
+public:
+  explicit DataForwarder(StreamWriter *out) : have_frames(false), out_(out) {}
+  void OnStreamData(const StreamDataChunk &chunk) final {
+    out_->StreamData(chunk);
+  }
+  void OnStreamSegment(const std::string &name, int loops) final {
+    // The implicit unnamed segment at the start needs no marker.
+    if (name.empty() && !have_frames) return;
+    out_->BeginSegment(name, loops);
+  }
+
+  bool have_frames;
+
+private:
+  StreamWriter *const out_;
+};
+}
+
+int TranscodeStream(StreamIO *in, FrameCanvas *scratch, StreamIO *out) {
+  StreamReader reader(in);
+  reader.SetLoopSegments(false);  // Keep loops, don't unroll them.
+  StreamWriter writer(out);
+  DataForwarder forwarder(&writer);
+  reader.SetDataListener(&forwarder);
+  int frames = 0;
+  uint32_t hold_time_us;
+  while (reader.GetNext(scratch, &hold_time_us)) {
+    if (!writer.Stream(*scratch, hold_time_us, reader.presentation_time_us()))
+      return -1;
+    forwarder.have_frames = true;
+    ++frames;
+  }
+  return reader.has_error() ? -1 : frames;
+}
+
+static int64_t GetMonotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+PlaybackClock::PlaybackClock() { Start(0); }
+
+void PlaybackClock::Start(uint64_t media_time_us) {
+  offset_us_ = (int64_t)media_time_us - GetMonotonicMicros();
+}
+
+uint64_t PlaybackClock::Now() const {
+  const int64_t now = GetMonotonicMicros() + offset_us_;
+  return now < 0 ? 0 : now;
+}
+
+void PlaybackClock::SyncTo(uint64_t media_time_us) {
+  Start(media_time_us);
+}
+
+uint64_t PlaybackClock::WaitUntil(uint64_t media_time_us) const {
+  const uint64_t now = Now();
+  if (now >= media_time_us)
+    return now - media_time_us;
+  const uint64_t wait_us = media_time_us - now;
+  struct timespec ts;
+  ts.tv_sec = wait_us / 1000000;
+  ts.tv_nsec = (wait_us % 1000000) * 1000;
+  nanosleep(&ts, NULL);
+  return 0;
+}
 }  // namespace rgb_matrix
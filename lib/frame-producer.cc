@@ -0,0 +1,216 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+#include "frame-producer.h"
+
+#include <errno.h>
+#include <time.h>
+
+#include <algorithm>
+
+namespace rgb_matrix {
+// Number of recent frames render time percentiles are calculated from.
+static const size_t kRenderTimeWindow = 512;
+
+static int64_t GetMonotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void SleepUntilMicros(int64_t when) {
+  struct timespec ts;
+  ts.tv_sec = when / 1000000;
+  ts.tv_nsec = (when % 1000000) * 1000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+}
+
+class FrameProducer::RenderThread : public Thread {
+public:
+  RenderThread(FrameProducer *producer) : producer_(producer) {}
+  virtual void Run() { producer_->RenderLoop(); }
+
+private:
+  FrameProducer *const producer_;
+};
+
+FrameProducer::FrameProducer(RGBMatrix *matrix, float target_fps,
+                             int render_ahead, unsigned vsync_multiple)
+  : matrix_(matrix),
+    period_usec_(target_fps > 0 ? (int64_t)(1e6 / target_fps) : 1),
+    render_ahead_(std::max(render_ahead, 0)),
+    vsync_multiple_(vsync_multiple > 0 ? vsync_multiple : 1),
+    start_usec_(0), next_frame_(0), rendering_(false),
+    rendered_(0), presented_(0), late_(0), dropped_(0) {
+  pthread_cond_init(&queue_changed_, NULL);
+  // One canvas to render into and one for each frame rendered ahead.
+  // The shown canvas is the one the last SwapOnVSync() returned.
+  for (int i = 0; i <= render_ahead_; ++i) {
+    free_.push_back(matrix_->CreateFrameCanvas());
+  }
+}
+
+FrameProducer::~FrameProducer() {
+  pthread_cond_destroy(&queue_changed_);
+}
+
+bool FrameProducer::RenderNext(FrameCanvas *canvas, uint64_t *frame) {
+  const int64_t start = GetMonotonicMicros();
+  uint64_t next = next_frame_;
+  // If we're behind, skip the frames whose deadline already passed: showing
+  // them late would slow down the whole animation.
+  if (start > Deadline(next)) {
+    const uint64_t in_time = (start - start_usec_) / period_usec_ + 1;
+    MutexLock l(&mutex_);
+    dropped_ += in_time - next;
+    next = in_time;
+  }
+  if (!RenderFrame(canvas, next))
+    return false;
+  const int64_t render_usec = GetMonotonicMicros() - start;
+  next_frame_ = next + 1;
+  *frame = next;
+
+  MutexLock l(&mutex_);
+  if (render_usec_.size() < kRenderTimeWindow)
+    render_usec_.push_back(render_usec);
+  else
+    render_usec_[rendered_ % kRenderTimeWindow] = render_usec;
+  ++rendered_;
+  return true;
+}
+
+void FrameProducer::Present(FrameCanvas *canvas, uint64_t frame) {
+  SleepUntilMicros(Deadline(frame));
+  FrameCanvas *previous = matrix_->SwapOnVSync(canvas, vsync_multiple_);
+  const bool late = GetMonotonicMicros() > Deadline(frame) + period_usec_;
+
+  MutexLock l(&mutex_);
+  ++presented_;
+  if (late) ++late_;
+  // Without a refresh thread (e.g. no hardware), nothing is shown and the
+  // canvas can be used again right away.
+  free_.push_back(previous != NULL ? previous : canvas);
+  pthread_cond_signal(&queue_changed_);
+}
+
+void FrameProducer::RenderLoop() {
+  for (;;) {
+    FrameCanvas *canvas;
+    {
+      MutexLock l(&mutex_);
+      while (free_.empty())
+        mutex_.WaitOn(&queue_changed_);
+      canvas = free_.back();
+      free_.pop_back();
+    }
+
+    QueuedFrame rendered;
+    rendered.canvas = canvas;
+    const bool keep_going = RenderNext(canvas, &rendered.frame);
+
+    MutexLock l(&mutex_);
+    if (keep_going) {
+      queue_.push_back(rendered);
+    } else {
+      free_.push_back(canvas);
+      rendering_ = false;
+    }
+    pthread_cond_signal(&queue_changed_);
+    if (!keep_going)
+      return;
+  }
+}
+
+void FrameProducer::Run() {
+  {
+    MutexLock l(&mutex_);
+    rendered_ = presented_ = late_ = dropped_ = 0;
+    render_usec_.clear();
+    rendering_ = true;
+  }
+  next_frame_ = 0;
+  // Leave one period to render the first frame.
+  start_usec_ = GetMonotonicMicros() + period_usec_;
+
+  if (render_ahead_ == 0) {
+    FrameCanvas *canvas = free_.back();
+    free_.pop_back();
+    uint64_t frame;
+    while (RenderNext(canvas, &frame)) {
+      Present(canvas, frame);
+      MutexLock l(&mutex_);
+      canvas = free_.back();
+      free_.pop_back();
+    }
+    free_.push_back(canvas);
+    return;
+  }
+
+  RenderThread render_thread(this);
+  render_thread.Start();
+  for (;;) {
+    QueuedFrame next;
+    {
+      MutexLock l(&mutex_);
+      while (queue_.empty() && rendering_)
+        mutex_.WaitOn(&queue_changed_);
+      if (queue_.empty())
+        break;   // Done rendering and everything is shown.
+      next = queue_.front();
+      queue_.pop_front();
+    }
+    Present(next.canvas, next.frame);
+  }
+  render_thread.WaitStopped();
+}
+
+FrameStats FrameProducer::GetStats() const {
+  FrameStats stats;
+  std::vector<int64_t> times;
+  {
+    MutexLock l(&mutex_);
+    stats.rendered = rendered_;
+    stats.presented = presented_;
+    stats.late = late_;
+    stats.dropped = dropped_;
+    times = render_usec_;
+  }
+  stats.render_p50_usec = stats.render_p90_usec = 0;
+  stats.render_p99_usec = stats.render_max_usec = 0;
+  if (!times.empty()) {
+    std::sort(times.begin(), times.end());
+    const size_t last = times.size() - 1;
+    stats.render_p50_usec = times[last * 50 / 100];
+    stats.render_p90_usec = times[last * 90 / 100];
+    stats.render_p99_usec = times[last * 99 / 100];
+    stats.render_max_usec = times[last];
+  }
+  return stats;
+}
+
+void FrameProducer::PrintStats(FILE *out) const {
+  const FrameStats stats = GetStats();
+  fprintf(out, "%.1f fps target: %llu frames shown, %llu late, %llu dropped; "
+          "render time p50=%lldus p90=%lldus p99=%lldus max=%lldus\n",
+          target_fps(),
+          (unsigned long long)stats.presented,
+          (unsigned long long)stats.late,
+          (unsigned long long)stats.dropped,
+          (long long)stats.render_p50_usec, (long long)stats.render_p90_usec,
+          (long long)stats.render_p99_usec, (long long)stats.render_max_usec);
+}
+}  // namespace rgb_matrix
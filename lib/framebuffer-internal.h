@@ -18,6 +18,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <vector>
+
 #include "hardware-mapping.h"
 #include "../include/graphics.h"
 
@@ -27,20 +29,45 @@ class PinPulser;
 namespace internal {
 class RowAddressSetter;
 
-// An opaque type used within the framebuffer that can be used
-// to copy between PixelMappers.
-struct PixelDesignator {
-  PixelDesignator() : gpio_word(-1), r_bit(0), g_bit(0), b_bit(0), mask(~0u){}
-  long gpio_word;
+// The gpio bits a pixel uses for its colors. There are only a few
+// different ones, one for each sub-panel of each parallel chain, so
+// they are kept in a small table in the PixelDesignatorMap.
+struct PixelColorBits {
+  PixelColorBits() : r_bit(0), g_bit(0), b_bit(0), mask(~0u) {}
   gpio_bits_t r_bit;
   gpio_bits_t g_bit;
   gpio_bits_t b_bit;
   gpio_bits_t mask;
 };
 
+// An opaque type used within the framebuffer that can be used
+// to copy between PixelMappers.
+// This is kept small, so that the map for large displays still fits into
+// the cache.
+struct PixelDesignator {
+  PixelDesignator() : gpio_word(-1), color_bits(0) {}
+  int32_t gpio_word;   // Offset in the bitplane buffer. -1: not used.
+  uint8_t color_bits;  // Index into PixelDesignatorMap::color_bits()
+};
+
+// Consecutive pixels of a row that use the same color bits and whose
+// gpio words are a constant "stride" apart. With most mappers, a row of
+// pixels consists of only a few such runs, so bulk operations can walk
+// them without looking at each PixelDesignator.
+struct PixelRun {
+  int x;            // First column of the run.
+  int length;
+  int32_t gpio_word;  // gpio word of the first pixel.
+  int32_t stride;     // gpio word distance from one pixel to the next.
+  uint8_t color_bits;
+};
+
 class PixelDesignatorMap {
 public:
-  PixelDesignatorMap(int width, int height, const PixelDesignator &fill_bits);
+  PixelDesignatorMap(int width, int height, const PixelColorBits &fill_bits);
+  // New map sharing the color bits of "parent", e.g. to re-arrange its
+  // PixelDesignators.
+  PixelDesignatorMap(int width, int height, const PixelDesignatorMap &parent);
   ~PixelDesignatorMap();
 
   // Get a writable version of the PixelDesignator. Outside Framebuffer used
@@ -51,13 +78,35 @@ public:
   inline int height() const { return height_; }
 
   // All bits that set red/green/blue pixels; used for Fill().
-  const PixelDesignator &GetFillColorBits() { return fill_bits_; }
+  const PixelColorBits &GetFillColorBits() { return fill_bits_; }
+
+  // Color bits referenced by PixelDesignator::color_bits.
+  const PixelColorBits &color_bits(uint8_t index) const {
+    return color_bits_[index];
+  }
+
+  // Returns the index of the given color bits, adding them to the table
+  // if needed.
+  uint8_t AddColorBits(const PixelColorBits &bits);
+
+  // Runs of used pixels in row "y", sorted by x. Only valid after
+  // UpdateRuns() has been called once all designators are set up.
+  const PixelRun *runs_begin(int y) const { return &runs_[row_runs_[y]]; }
+  const PixelRun *runs_end(int y) const { return &runs_[row_runs_[y + 1]]; }
+  void UpdateRuns();
 
 private:
+  // Two sub-panels for each of up to 6 parallel chains, plus unused pixels.
+  static constexpr int kMaxColorBits = 16;
+
   const int width_;
   const int height_;
-  const PixelDesignator fill_bits_;  // Precalculated for fill.
+  const PixelColorBits fill_bits_;  // Precalculated for fill.
   PixelDesignator *const buffer_;
+  PixelColorBits color_bits_[kMaxColorBits];
+  int color_bits_count_;
+  std::vector<PixelRun> runs_;
+  std::vector<int> row_runs_;   // Index of first run of each row.
 };
 
 // Internal representation of the frame-buffer that as well can
@@ -87,17 +136,24 @@ public:
   Framebuffer(int rows, int columns, int parallel,
               int scan_mode,
               const char* led_sequence, bool inverse_color,
+              const struct HardwareMapping *hardware_mapping,
               PixelDesignatorMap **mapper);
   ~Framebuffer();
 
+  // Returns the hardware mapping with the given name, "regular" if empty.
+  // Aborts if there is no such mapping.
+  static const struct HardwareMapping *FindHardwareMapping(
+    const char *named_hardware);
+
   // Initialize GPIO bits for output. Only call once.
-  static void InitHardwareMapping(const char *named_hardware);
-  static void InitGPIO(GPIO *io, int rows, int parallel,
+  static void InitGPIO(GPIO *io, const struct HardwareMapping &h,
+                       int rows, int parallel,
                        bool allow_hardware_pulsing,
                        int pwm_lsb_nanoseconds,
                        int dither_bits,
                        int row_address_type);
-  static void InitializePanels(GPIO *io, const char *panel_type, int columns);
+  static void InitializePanels(GPIO *io, const struct HardwareMapping &h,
+                               const char *panel_type, int columns);
 
   // Set PWM bits used for output. Default is 11, but if you only deal with
   // simple comic-colors, 1 might be sufficient. Lower require less CPU.
@@ -106,16 +162,25 @@ public:
   uint8_t pwmbits() { return pwm_bits_; }
 
   // Map brightness of output linearly to input with CIE1931 profile.
-  void set_luminance_correct(bool on) { do_luminance_correct_ = on; }
+  void set_luminance_correct(bool on) {
+    do_luminance_correct_ = on;
+    color_lut_valid_ = false;
+  }
   bool luminance_correct() const { return do_luminance_correct_; }
 
   // Set brightness in percent; range=1..100
   // This will only affect newly set pixels.
   void SetBrightness(uint8_t b) {
     brightness_ = (b <= 100 ? (b != 0 ? b : 1) : 100);
+    color_lut_valid_ = false;
   }
   uint8_t brightness() { return brightness_; }
 
+  // The hardware mapping the bitplanes are set up for.
+  const struct HardwareMapping &hardware_mapping() const {
+    return *hardware_mapping_;
+  }
+
   void DumpToMatrix(GPIO *io, int pwm_bits_to_show);
 
   void Serialize(const char **data, size_t *len) const;
@@ -127,12 +192,19 @@ public:
   int width() const;
   int height() const;
   void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue);
-  void SetPixels(int x, int y, int width, int height, Color *colors);
+  void SetPixels(int x, int y, int width, int height, const Color *colors);
+  void FillRect(int x, int y, int width, int height,
+                uint8_t red, uint8_t green, uint8_t blue);
   void Clear();
   void Fill(uint8_t red, uint8_t green, uint8_t blue);
 
+  // Copy a rectangle from "src", which needs to share the pixel mapping of
+  // this framebuffer, to "dst_x", "dst_y". "src" can be this framebuffer.
+  void Blit(const Framebuffer *src, int src_x, int src_y,
+            int width, int height, int dst_x, int dst_y);
+  void ScrollBy(int dx, int dy);
+
 private:
-  static const struct HardwareMapping *hardware_mapping_;
   static RowAddressSetter *row_setter_;
 
   // This returns the gpio-bit for given color (one of 'R', 'G', 'B'). This is
@@ -146,6 +218,9 @@ private:
                              PixelDesignator *designator);
   inline void  MapColors(uint8_t r, uint8_t g, uint8_t b,
                          uint16_t *red, uint16_t *green, uint16_t *blue);
+  // MapColors() of all 256 values of a color channel.
+  inline const uint16_t *color_lut();
+  const struct HardwareMapping *const hardware_mapping_;
   const int rows_;     // Number of rows. 16 or 32.
   const int parallel_; // Parallel rows of chains. 1 or 2.
   const int height_;   // rows * parallel
@@ -158,6 +233,10 @@ private:
   bool do_luminance_correct_;
   uint8_t brightness_;
 
+  // Rebuilt on first use after brightness or luminance correction changed.
+  uint16_t color_lut_[256];
+  bool color_lut_valid_;
+
   const int double_rows_;
   const size_t buffer_size_;
 
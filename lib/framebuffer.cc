@@ -51,15 +51,70 @@ PixelDesignator *PixelDesignatorMap::get(int x, int y) {
 }
 
 PixelDesignatorMap::PixelDesignatorMap(int width, int height,
-                                       const PixelDesignator &fill_bits)
+                                       const PixelColorBits &fill_bits)
   : width_(width), height_(height), fill_bits_(fill_bits),
-    buffer_(new PixelDesignator[width * height]) {
+    buffer_(new PixelDesignator[width * height]), color_bits_count_(0) {
+}
+
+PixelDesignatorMap::PixelDesignatorMap(int width, int height,
+                                       const PixelDesignatorMap &parent)
+  : width_(width), height_(height), fill_bits_(parent.fill_bits_),
+    buffer_(new PixelDesignator[width * height]),
+    color_bits_count_(parent.color_bits_count_) {
+  std::copy(parent.color_bits_, parent.color_bits_ + color_bits_count_,
+            color_bits_);
 }
 
 PixelDesignatorMap::~PixelDesignatorMap() {
   delete [] buffer_;
 }
 
+void PixelDesignatorMap::UpdateRuns() {
+  runs_.clear();
+  row_runs_.resize(height_ + 1);
+  for (int y = 0; y < height_; ++y) {
+    row_runs_[y] = runs_.size();
+    const PixelDesignator *row = buffer_ + y * width_;
+    PixelRun *run = NULL;
+    for (int x = 0; x < width_; ++x) {
+      const PixelDesignator &d = row[x];
+      if (d.gpio_word < 0) {  // non-used pixel marker.
+        run = NULL;
+        continue;
+      }
+      if (run != NULL && d.color_bits == run->color_bits) {
+        const int32_t stride = d.gpio_word - row[x - 1].gpio_word;
+        if (run->length == 1) run->stride = stride;
+        if (stride == run->stride) {
+          run->length++;
+          continue;
+        }
+      }
+      PixelRun new_run;
+      new_run.x = x;
+      new_run.length = 1;
+      new_run.gpio_word = d.gpio_word;
+      new_run.stride = 1;
+      new_run.color_bits = d.color_bits;
+      runs_.push_back(new_run);
+      run = &runs_.back();
+    }
+  }
+  row_runs_[height_] = runs_.size();
+}
+
+uint8_t PixelDesignatorMap::AddColorBits(const PixelColorBits &bits) {
+  for (int i = 0; i < color_bits_count_; ++i) {
+    const PixelColorBits &existing = color_bits_[i];
+    if (existing.r_bit == bits.r_bit && existing.g_bit == bits.g_bit
+        && existing.b_bit == bits.b_bit && existing.mask == bits.mask)
+      return i;
+  }
+  assert(color_bits_count_ < kMaxColorBits);
+  color_bits_[color_bits_count_] = bits;
+  return color_bits_count_++;
+}
+
 // Different panel types use different techniques to set the row address.
 // We abstract that away with different implementations of RowAddressSetter
 class RowAddressSetter {
@@ -281,31 +336,53 @@ private:
 
 }
 
-const struct HardwareMapping *Framebuffer::hardware_mapping_ = NULL;
 RowAddressSetter *Framebuffer::row_setter_ = NULL;
 
+// Number of parallel chains the mapping has color bits for, unless given
+// explicitly.
+static int MaxParallelChains(const struct HardwareMapping &h) {
+  if (h.max_parallel_chains > 0) return h.max_parallel_chains;
+  int result = 0;
+  if ((h.p0_r1 | h.p0_g1 | h.p0_g1 | h.p0_r2 | h.p0_g2 | h.p0_g2) > 0)
+    ++result;
+  if ((h.p1_r1 | h.p1_g1 | h.p1_g1 | h.p1_r2 | h.p1_g2 | h.p1_g2) > 0)
+    ++result;
+  if ((h.p2_r1 | h.p2_g1 | h.p2_g1 | h.p2_r2 | h.p2_g2 | h.p2_g2) > 0)
+    ++result;
+  if ((h.p3_r1 | h.p3_g1 | h.p3_g1 | h.p3_r2 | h.p3_g2 | h.p3_g2) > 0)
+    ++result;
+  if ((h.p4_r1 | h.p4_g1 | h.p4_g1 | h.p4_r2 | h.p4_g2 | h.p4_g2) > 0)
+    ++result;
+  if ((h.p5_r1 | h.p5_g1 | h.p5_g1 | h.p5_r2 | h.p5_g2 | h.p5_g2) > 0)
+    ++result;
+  return result;
+}
+
 Framebuffer::Framebuffer(int rows, int columns, int parallel,
                          int scan_mode,
                          const char *led_sequence, bool inverse_color,
+                         const struct HardwareMapping *hardware_mapping,
                          PixelDesignatorMap **mapper)
-  : rows_(rows),
+  : hardware_mapping_(hardware_mapping),
+    rows_(rows),
     parallel_(parallel),
     height_(rows * parallel),
     columns_(columns),
     scan_mode_(scan_mode),
     inverse_color_(inverse_color),
     pwm_bits_(kBitPlanes), do_luminance_correct_(true), brightness_(100),
+    color_lut_valid_(false),
     double_rows_(rows / SUB_PANELS_),
     buffer_size_(double_rows_ * columns_ * kBitPlanes * sizeof(gpio_bits_t)),
     shared_mapper_(mapper) {
-  assert(hardware_mapping_ != NULL);   // Called InitHardwareMapping() ?
+  assert(hardware_mapping_ != NULL);   // See FindHardwareMapping()
   assert(shared_mapper_ != NULL);  // Storage should be provided by RGBMatrix.
   assert(rows_ >=4 && rows_ <= 64 && rows_ % 2 == 0);
-  if (parallel > hardware_mapping_->max_parallel_chains) {
+  const int max_parallel = MaxParallelChains(*hardware_mapping_);
+  if (parallel > max_parallel) {
     fprintf(stderr, "The %s GPIO mapping only supports %d parallel chain%s, "
             "but %d was requested.\n", hardware_mapping_->name,
-            hardware_mapping_->max_parallel_chains,
-            hardware_mapping_->max_parallel_chains > 1 ? "s" : "", parallel);
+            max_parallel, max_parallel > 1 ? "s" : "", parallel);
     abort();
   }
   assert(parallel >= 1 && parallel <= 6);
@@ -327,7 +404,7 @@ Framebuffer::Framebuffer(int rows, int columns, int parallel,
     gpio_bits_t r = h.p0_r1 | h.p0_r2 | h.p1_r1 | h.p1_r2 | h.p2_r1 | h.p2_r2 | h.p3_r1 | h.p3_r2 | h.p4_r1 | h.p4_r2 | h.p5_r1 | h.p5_r2;
     gpio_bits_t g = h.p0_g1 | h.p0_g2 | h.p1_g1 | h.p1_g2 | h.p2_g1 | h.p2_g2 | h.p3_g1 | h.p3_g2 | h.p4_g1 | h.p4_g2 | h.p5_g1 | h.p5_g2;
     gpio_bits_t b = h.p0_b1 | h.p0_b2 | h.p1_b1 | h.p1_b2 | h.p2_b1 | h.p2_b2 | h.p3_b1 | h.p3_b2 | h.p4_b1 | h.p4_b2 | h.p5_b1 | h.p5_b2;
-    PixelDesignator fill_bits;
+    PixelColorBits fill_bits;
     fill_bits.r_bit = GetGpioFromLedSequence('R', led_sequence, r, g, b);
     fill_bits.g_bit = GetGpioFromLedSequence('G', led_sequence, r, g, b);
     fill_bits.b_bit = GetGpioFromLedSequence('B', led_sequence, r, g, b);
@@ -338,6 +415,7 @@ Framebuffer::Framebuffer(int rows, int columns, int parallel,
         InitDefaultDesignator(x, y, led_sequence, (*shared_mapper_)->get(x, y));
       }
     }
+    (*shared_mapper_)->UpdateRuns();
   }
 
   Clear();
@@ -349,12 +427,13 @@ Framebuffer::~Framebuffer() {
 
 // TODO: this should also be parsed from some special formatted string, e.g.
 // {addr={22,23,24,25,15},oe=18,clk=17,strobe=4, p0={11,27,7,8,9,10},...}
-/* static */ void Framebuffer::InitHardwareMapping(const char *named_hardware) {
+/* static */ const struct HardwareMapping *
+Framebuffer::FindHardwareMapping(const char *named_hardware) {
   if (named_hardware == NULL || *named_hardware == '\0') {
     named_hardware = "regular";
   }
 
-  struct HardwareMapping *mapping = NULL;
+  const struct HardwareMapping *mapping = NULL;
   for (HardwareMapping *it = matrix_hardware_mappings; it->name; ++it) {
     if (strcasecmp(it->name, named_hardware) == 0) {
       mapping = it;
@@ -373,26 +452,12 @@ Framebuffer::~Framebuffer() {
     abort();
   }
 
-  if (mapping->max_parallel_chains == 0) {
-    // Auto determine.
-    struct HardwareMapping *h = mapping;
-    if ((h->p0_r1 | h->p0_g1 | h->p0_g1 | h->p0_r2 | h->p0_g2 | h->p0_g2) > 0)
-      ++mapping->max_parallel_chains;
-    if ((h->p1_r1 | h->p1_g1 | h->p1_g1 | h->p1_r2 | h->p1_g2 | h->p1_g2) > 0)
-      ++mapping->max_parallel_chains;
-    if ((h->p2_r1 | h->p2_g1 | h->p2_g1 | h->p2_r2 | h->p2_g2 | h->p2_g2) > 0)
-      ++mapping->max_parallel_chains;
-    if ((h->p3_r1 | h->p3_g1 | h->p3_g1 | h->p3_r2 | h->p3_g2 | h->p3_g2) > 0)
-      ++mapping->max_parallel_chains;
-    if ((h->p4_r1 | h->p4_g1 | h->p4_g1 | h->p4_r2 | h->p4_g2 | h->p4_g2) > 0)
-      ++mapping->max_parallel_chains;
-    if ((h->p5_r1 | h->p5_g1 | h->p5_g1 | h->p5_r2 | h->p5_g2 | h->p5_g2) > 0)
-      ++mapping->max_parallel_chains;
-  }
-  hardware_mapping_ = mapping;
+  return mapping;
 }
 
-/* static */ void Framebuffer::InitGPIO(GPIO *io, int rows, int parallel,
+/* static */ void Framebuffer::InitGPIO(GPIO *io,
+                                        const struct HardwareMapping &h,
+                                        int rows, int parallel,
                                         bool allow_hardware_pulsing,
                                         int pwm_lsb_nanoseconds,
                                         int dither_bits,
@@ -400,7 +465,6 @@ Framebuffer::~Framebuffer() {
   if (sOutputEnablePulser != NULL)
     return;  // already initialized.
 
-  const struct HardwareMapping &h = *hardware_mapping_;
   // Tell GPIO about all bits we intend to use.
   gpio_bits_t all_used_bits = 0;
 
@@ -551,14 +615,15 @@ static void InitFM6127(GPIO *io, const struct HardwareMapping &h, int columns) {
 }
 
 /*static*/ void Framebuffer::InitializePanels(GPIO *io,
+                                              const struct HardwareMapping &h,
                                               const char *panel_type,
                                               int columns) {
   if (!panel_type || panel_type[0] == '\0') return;
   if (strncasecmp(panel_type, "fm6126", 6) == 0) {
-    InitFM6126(io, *hardware_mapping_, columns);
+    InitFM6126(io, h, columns);
   }
   else if (strncasecmp(panel_type, "fm6127", 6) == 0) {
-    InitFM6127(io, *hardware_mapping_, columns);
+    InitFM6127(io, h, columns);
   }
   // else if (strncasecmp(...))  // more init types
   else {
@@ -570,6 +635,7 @@ bool Framebuffer::SetPWMBits(uint8_t value) {
   if (value < 1 || value > kBitPlanes)
     return false;
   pwm_bits_ = value;
+  color_lut_valid_ = false;
   return true;
 }
 
@@ -644,10 +710,23 @@ inline void Framebuffer::MapColors(
   }
 }
 
+// Brightness, luminance correction and inversion are the same for all
+// pixels, so we map all possible values once instead of per pixel.
+inline const uint16_t *Framebuffer::color_lut() {
+  if (!color_lut_valid_) {
+    for (int c = 0; c < 256; ++c) {
+      uint16_t ignore;
+      MapColors(c, 0, 0, &color_lut_[c], &ignore, &ignore);
+    }
+    color_lut_valid_ = true;
+  }
+  return color_lut_;
+}
+
 void Framebuffer::Fill(uint8_t r, uint8_t g, uint8_t b) {
   uint16_t red, green, blue;
   MapColors(r, g, b, &red, &green, &blue);
-  const PixelDesignator &fill = (*shared_mapper_)->GetFillColorBits();
+  const PixelColorBits &fill = (*shared_mapper_)->GetFillColorBits();
 
   for (int bits = kBitPlanes - pwm_bits_; bits < kBitPlanes; ++bits) {
     uint16_t mask = 1 << bits;
@@ -668,8 +747,66 @@ void Framebuffer::Fill(uint8_t r, uint8_t g, uint8_t b) {
 int Framebuffer::width() const { return (*shared_mapper_)->width(); }
 int Framebuffer::height() const { return (*shared_mapper_)->height(); }
 
+// Write already mapped colors into all bitplanes of a pixel using the
+// "designator" color bits. "bits" points to the lowest bitplane to be set.
+static inline void WritePlanes(const PixelColorBits &designator,
+                               gpio_bits_t *bits, int stride,
+                               int min_bit_plane, int max_bit_plane,
+                               uint16_t red, uint16_t green, uint16_t blue) {
+  const gpio_bits_t r_bits = designator.r_bit;
+  const gpio_bits_t g_bits = designator.g_bit;
+  const gpio_bits_t b_bits = designator.b_bit;
+  const gpio_bits_t designator_mask = designator.mask;
+  for (uint16_t mask = 1<<min_bit_plane; mask != 1<<max_bit_plane; mask <<=1) {
+    gpio_bits_t color_bits = 0;
+    if (red & mask)   color_bits |= r_bits;
+    if (green & mask) color_bits |= g_bits;
+    if (blue & mask)  color_bits |= b_bits;
+    *bits = (*bits & designator_mask) | color_bits;
+    bits += stride;
+  }
+}
+
+// Number of pixels SetPixels() converts at a time.
+static const int kPixelChunk = 64;
+
+// Write "count" colors of a run into all bitplanes. The mapped colors are
+// kept in a scratch buffer, then each plane is written in one go without
+// branches, which the compiler can vectorize for consecutive pixels.
+static void WriteChunkPlanes(const PixelColorBits &designator,
+                             gpio_bits_t *bits, int pixel_stride,
+                             int plane_stride,
+                             int min_bit_plane, int max_bit_plane,
+                             const uint16_t *lut, const Color *colors,
+                             int count) {
+  alignas(16) uint16_t red[kPixelChunk];
+  alignas(16) uint16_t green[kPixelChunk];
+  alignas(16) uint16_t blue[kPixelChunk];
+  for (int i = 0; i < count; ++i) {
+    red[i] = lut[colors[i].r];
+    green[i] = lut[colors[i].g];
+    blue[i] = lut[colors[i].b];
+  }
+  const gpio_bits_t r_bits = designator.r_bit;
+  const gpio_bits_t g_bits = designator.g_bit;
+  const gpio_bits_t b_bits = designator.b_bit;
+  const gpio_bits_t designator_mask = designator.mask;
+  for (int plane = min_bit_plane; plane < max_bit_plane; ++plane) {
+    gpio_bits_t *pos = bits;
+    for (int i = 0; i < count; ++i, pos += pixel_stride) {
+      const gpio_bits_t color_bits
+        = (r_bits & -(gpio_bits_t)((red[i] >> plane) & 1))
+        | (g_bits & -(gpio_bits_t)((green[i] >> plane) & 1))
+        | (b_bits & -(gpio_bits_t)((blue[i] >> plane) & 1));
+      *pos = (*pos & designator_mask) | color_bits;
+    }
+    bits += plane_stride;
+  }
+}
+
 void Framebuffer::SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
-  const PixelDesignator *designator = (*shared_mapper_)->get(x, y);
+  PixelDesignatorMap *const mapper = *shared_mapper_;
+  const PixelDesignator *designator = mapper->get(x, y);
   if (designator == NULL) return;
   const long pos = designator->gpio_word;
   if (pos < 0) return;  // non-used pixel marker.
@@ -677,31 +814,295 @@ void Framebuffer::SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
   uint16_t red, green, blue;
   MapColors(r, g, b, &red, &green, &blue);
 
-  gpio_bits_t *bits = bitplane_buffer_ + pos;
   const int min_bit_plane = kBitPlanes - pwm_bits_;
-  bits += (columns_ * min_bit_plane);
-  const gpio_bits_t r_bits = designator->r_bit;
-  const gpio_bits_t g_bits = designator->g_bit;
-  const gpio_bits_t b_bits = designator->b_bit;
-  const gpio_bits_t designator_mask = designator->mask;
-  for (uint16_t mask = 1<<min_bit_plane; mask != 1<<kBitPlanes; mask <<=1 ) {
-    gpio_bits_t color_bits = 0;
-    if (red & mask)   color_bits |= r_bits;
-    if (green & mask) color_bits |= g_bits;
-    if (blue & mask)  color_bits |= b_bits;
-    *bits = (*bits & designator_mask) | color_bits;
-    bits += columns_;
+  WritePlanes(mapper->color_bits(designator->color_bits),
+              bitplane_buffer_ + pos + columns_ * min_bit_plane,
+              columns_, min_bit_plane, kBitPlanes, red, green, blue);
+}
+
+// Most rows that SetPixels() writes together at a time.
+static const int kMaxRowTile = 16;
+
+// Returns how many rows, starting at "row", have the same runs, just at
+// neighbouring gpio words: the runs of row + k start "k * *word_step"
+// words later. That is the case when rotated: a canvas row is a panel
+// column then, and the next canvas row is the next panel column. Only
+// looks for that if the runs have a stride other than 1.
+static int FindRowTile(const PixelDesignatorMap &mapper, int row, int max_rows,
+                       int *word_step) {
+  const PixelRun *const begin = mapper.runs_begin(row);
+  const PixelRun *const end = mapper.runs_end(row);
+  if (begin == end || begin->stride == 1 || max_rows < 2) return 1;
+  const int run_count = end - begin;
+  const PixelRun *const next = mapper.runs_begin(row + 1);
+  if (next == mapper.runs_end(row + 1)) return 1;  // No mapped pixels.
+  const int step = next->gpio_word - begin->gpio_word;
+  if (step != 1 && step != -1) return 1;
+  int rows = 1;
+  for (; rows < std::min(max_rows, kMaxRowTile); ++rows) {
+    const PixelRun *other = mapper.runs_begin(row + rows);
+    if (mapper.runs_end(row + rows) - other != run_count) break;
+    bool same = true;
+    for (const PixelRun *run = begin; run != end && same; ++run, ++other) {
+      same = (other->x == run->x && other->length == run->length
+              && other->stride == run->stride
+              && other->color_bits == run->color_bits
+              && other->gpio_word == run->gpio_word + rows * step);
+    }
+    if (!same) break;
+  }
+  *word_step = step;
+  return rows;
+}
+
+void Framebuffer::SetPixels(int x, int y, int width, int height,
+                            const Color *colors) {
+  PixelDesignatorMap *const mapper = *shared_mapper_;
+  const int stride = width;
+
+  // Clip to the canvas, while keeping the row stride through colors.
+  if (x < 0) { colors -= x; width += x; x = 0; }
+  if (y < 0) { colors -= y * stride; height += y; y = 0; }
+  if (x + width > mapper->width()) width = mapper->width() - x;
+  if (y + height > mapper->height()) height = mapper->height() - y;
+  if (width <= 0 || height <= 0) return;
+
+  const uint16_t *const lut = color_lut();
+  const int min_bit_plane = kBitPlanes - pwm_bits_;
+  gpio_bits_t *const first_plane = bitplane_buffer_ + columns_ * min_bit_plane;
+  const int x_end = x + width;
+  for (int row = 0; row < height; ++row, colors += stride) {
+    int word_step;
+    const int tile_rows = FindRowTile(*mapper, y + row, height - row,
+                                      &word_step);
+    if (tile_rows > 1) {
+      // Runs with a large stride touch a new cache line for each pixel and
+      // plane. But the pixels of the rows in the tile are next to each
+      // other, so we go column by column through the tile instead.
+      const PixelRun *const end = mapper->runs_end(y + row);
+      for (const PixelRun *run = mapper->runs_begin(y + row); run != end;
+           ++run) {
+        if (run->x >= x_end) break;
+        const int first = std::max(x, run->x);
+        const int last = std::min(x_end, run->x + run->length);
+        const PixelColorBits &bits = mapper->color_bits(run->color_bits);
+        gpio_bits_t *pos = first_plane + run->gpio_word
+          + (first - run->x) * run->stride;
+        for (int i = first; i < last; ++i, pos += run->stride) {
+          Color column[kMaxRowTile];
+          for (int k = 0; k < tile_rows; ++k) {
+            column[k] = colors[k * stride + i - x];
+          }
+          WriteChunkPlanes(bits, pos, word_step, columns_,
+                           min_bit_plane, kBitPlanes, lut, column, tile_rows);
+        }
+      }
+      row += tile_rows - 1;
+      colors += (tile_rows - 1) * stride;
+      continue;
+    }
+
+    const PixelRun *const end = mapper->runs_end(y + row);
+    for (const PixelRun *run = mapper->runs_begin(y + row); run != end; ++run) {
+      if (run->x >= x_end) break;
+      const int first = std::max(x, run->x);
+      const int last = std::min(x_end, run->x + run->length);
+      if (first >= last) continue;
+      const PixelColorBits &bits = mapper->color_bits(run->color_bits);
+      gpio_bits_t *pos = first_plane + run->gpio_word
+        + (first - run->x) * run->stride;
+      const Color *c = colors + (first - x);
+      for (int i = first; i < last; i += kPixelChunk) {
+        const int count = std::min(kPixelChunk, last - i);
+        WriteChunkPlanes(bits, pos, run->stride, columns_,
+                         min_bit_plane, kBitPlanes, lut, c, count);
+        pos += count * run->stride;
+        c += count;
+      }
+    }
+  }
+}
+
+void Framebuffer::FillRect(int x, int y, int width, int height,
+                           uint8_t r, uint8_t g, uint8_t b) {
+  PixelDesignatorMap *const mapper = *shared_mapper_;
+  if (x < 0) { width += x; x = 0; }
+  if (y < 0) { height += y; y = 0; }
+  if (x + width > mapper->width()) width = mapper->width() - x;
+  if (y + height > mapper->height()) height = mapper->height() - y;
+  if (width <= 0 || height <= 0) return;
+
+  uint16_t red, green, blue;
+  MapColors(r, g, b, &red, &green, &blue);
+
+  // All pixels of a run have the same color bits, just at a different
+  // gpio_word. So we prepare the bits for each plane once for the run, or
+  // keep them if the next run uses the same bits.
+  const int min_bit_plane = kBitPlanes - pwm_bits_;
+  gpio_bits_t *const first_plane = bitplane_buffer_ + columns_ * min_bit_plane;
+  gpio_bits_t plane_bits[kBitPlanes];
+  int last_color_bits = -1;
+  gpio_bits_t designator_mask = 0;
+  const int x_end = x + width;
+  for (int row = y; row < y + height; ++row) {
+    const PixelRun *const end = mapper->runs_end(row);
+    for (const PixelRun *run = mapper->runs_begin(row); run != end; ++run) {
+      if (run->x >= x_end) break;
+      const int first = std::max(x, run->x);
+      const int last = std::min(x_end, run->x + run->length);
+      if (first >= last) continue;
+      if (run->color_bits != last_color_bits) {
+        const PixelColorBits &bits = mapper->color_bits(run->color_bits);
+        for (int plane = min_bit_plane; plane < kBitPlanes; ++plane) {
+          const uint16_t mask = 1 << plane;
+          gpio_bits_t color_bits = 0;
+          if (red & mask)   color_bits |= bits.r_bit;
+          if (green & mask) color_bits |= bits.g_bit;
+          if (blue & mask)  color_bits |= bits.b_bit;
+          plane_bits[plane] = color_bits;
+        }
+        designator_mask = bits.mask;
+        last_color_bits = run->color_bits;
+      }
+      gpio_bits_t *pos = first_plane + run->gpio_word
+        + (first - run->x) * run->stride;
+      for (int i = first; i < last; ++i, pos += run->stride) {
+        gpio_bits_t *bits = pos;
+        for (int plane = min_bit_plane; plane < kBitPlanes; ++plane) {
+          *bits = (*bits & designator_mask) | plane_bits[plane];
+          bits += columns_;
+        }
+      }
+    }
+  }
+}
+
+namespace {
+// Part of a row to be copied in Blit(), where source and destination
+// pixels are in a PixelRun each.
+struct BlitSegment {
+  int count;
+  int32_t src_word;
+  int32_t src_stride;
+  uint8_t src_color_bits;
+  int32_t dst_word;
+  int32_t dst_stride;
+  uint8_t dst_color_bits;
+};
+}  // anonymous namespace
+
+// Copy all bitplanes of "count" pixels. If source and destination pixels
+// use the same color bits, this is merging the words. Otherwise, the
+// color bits are translated, e.g. when moving between upper and lower half.
+static void CopyPlanes(const gpio_bits_t *src, int src_stride,
+                       const PixelColorBits &from,
+                       gpio_bits_t *dst, int dst_stride,
+                       const PixelColorBits &to,
+                       int count, int plane_stride, int planes) {
+  const bool same_bits = (from.r_bit == to.r_bit && from.g_bit == to.g_bit
+                          && from.b_bit == to.b_bit);
+  const gpio_bits_t keep_mask = to.mask;
+  for (int plane = 0; plane < planes; ++plane) {
+    const gpio_bits_t *s = src;
+    gpio_bits_t *d = dst;
+    if (same_bits) {
+      for (int i = 0; i < count; ++i, s += src_stride, d += dst_stride) {
+        *d = (*d & keep_mask) | (*s & ~keep_mask);
+      }
+    } else {
+      for (int i = 0; i < count; ++i, s += src_stride, d += dst_stride) {
+        const gpio_bits_t value = *s;
+        gpio_bits_t color_bits = 0;
+        if (value & from.r_bit) color_bits |= to.r_bit;
+        if (value & from.g_bit) color_bits |= to.g_bit;
+        if (value & from.b_bit) color_bits |= to.b_bit;
+        *d = (*d & keep_mask) | color_bits;
+      }
+    }
+    src += plane_stride;
+    dst += plane_stride;
   }
 }
 
-void Framebuffer::SetPixels(int x, int y, int width, int height, Color *colors) {
-  for (int iy = 0; iy < height; ++iy) {
-    for (int ix = 0; ix < width; ++ix) {
-      SetPixel(x + ix, y + iy, colors->r, colors->g, colors->b);
-      ++colors;
+void Framebuffer::Blit(const Framebuffer *src, int src_x, int src_y,
+                       int width, int height, int dst_x, int dst_y) {
+  PixelDesignatorMap *const mapper = *shared_mapper_;
+  // Clip source and destination rectangle.
+  if (src_x < 0) { dst_x -= src_x; width += src_x; src_x = 0; }
+  if (src_y < 0) { dst_y -= src_y; height += src_y; src_y = 0; }
+  if (dst_x < 0) { src_x -= dst_x; width += dst_x; dst_x = 0; }
+  if (dst_y < 0) { src_y -= dst_y; height += dst_y; dst_y = 0; }
+  width = std::min(width, mapper->width() - std::max(src_x, dst_x));
+  height = std::min(height, mapper->height() - std::max(src_y, dst_y));
+  if (width <= 0 || height <= 0) return;
+
+  // If we copy within the same buffer, go in the opposite direction of the
+  // movement, so that we never read pixels that we already overwrote.
+  const bool bottom_up = (src == this && dst_y > src_y);
+  const bool right_to_left = (src == this && dst_x > src_x);
+  const gpio_bits_t *const src_bits = src->bitplane_buffer_;
+  std::vector<BlitSegment> segments;
+  for (int n = 0; n < height; ++n) {
+    const int row = bottom_up ? height - 1 - n : n;
+
+    // Intersect the runs of source and destination row. Positions are
+    // relative to the start of the rectangle.
+    segments.clear();
+    const PixelRun *s = mapper->runs_begin(src_y + row);
+    const PixelRun *const s_end = mapper->runs_end(src_y + row);
+    const PixelRun *d = mapper->runs_begin(dst_y + row);
+    const PixelRun *const d_end = mapper->runs_end(dst_y + row);
+    while (s != s_end && d != d_end) {
+      const int s_last = s->x + s->length - src_x;
+      const int d_last = d->x + d->length - dst_x;
+      const int first = std::max(std::max(s->x - src_x, d->x - dst_x), 0);
+      const int last = std::min(std::min(s_last, d_last), width);
+      if (first < last) {
+        BlitSegment segment;
+        segment.count = last - first;
+        segment.src_word = s->gpio_word + (first + src_x - s->x) * s->stride;
+        segment.src_stride = s->stride;
+        segment.src_color_bits = s->color_bits;
+        segment.dst_word = d->gpio_word + (first + dst_x - d->x) * d->stride;
+        segment.dst_stride = d->stride;
+        segment.dst_color_bits = d->color_bits;
+        segments.push_back(segment);
+      }
+      if (s_last < d_last) ++s; else ++d;
+    }
+
+    for (size_t i = 0; i < segments.size(); ++i) {
+      const BlitSegment &segment
+        = segments[right_to_left ? segments.size() - 1 - i : i];
+      const PixelColorBits &from = mapper->color_bits(segment.src_color_bits);
+      const PixelColorBits &to = mapper->color_bits(segment.dst_color_bits);
+      if (right_to_left) {
+        // Start with the last pixel and go backwards.
+        const int last = segment.count - 1;
+        CopyPlanes(src_bits + segment.src_word + last * segment.src_stride,
+                   -segment.src_stride, from,
+                   bitplane_buffer_ + segment.dst_word
+                   + last * segment.dst_stride,
+                   -segment.dst_stride, to,
+                   segment.count, columns_, kBitPlanes);
+      } else {
+        CopyPlanes(src_bits + segment.src_word, segment.src_stride, from,
+                   bitplane_buffer_ + segment.dst_word, segment.dst_stride, to,
+                   segment.count, columns_, kBitPlanes);
+      }
     }
   }
 }
+
+void Framebuffer::ScrollBy(int dx, int dy) {
+  const int w = width();
+  const int h = height();
+  Blit(this, 0, 0, w, h, dx, dy);
+  // Uncovered area becomes black.
+  FillRect(dx >= 0 ? 0 : w + dx, 0, std::min(abs(dx), w), h, 0, 0, 0);
+  FillRect(0, dy >= 0 ? 0 : h + dy, w, std::min(abs(dy), h), 0, 0, 0);
+}
+
 // Strange LED-mappings such as RBG or so are handled here.
 gpio_bits_t Framebuffer::GetGpioFromLedSequence(char col,
                                                 const char *led_sequence,
@@ -728,76 +1129,77 @@ void Framebuffer::InitDefaultDesignator(int x, int y, const char *seq,
   const struct HardwareMapping &h = *hardware_mapping_;
   gpio_bits_t *bits = ValueAt(y % double_rows_, x, 0);
   d->gpio_word = bits - bitplane_buffer_;
-  d->r_bit = d->g_bit = d->b_bit = 0;
+  PixelColorBits c;
   if (y < rows_) {
     if (y < double_rows_) {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p0_r1, h.p0_g1, h.p0_b1);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p0_r1, h.p0_g1, h.p0_b1);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p0_r1, h.p0_g1, h.p0_b1);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p0_r1, h.p0_g1, h.p0_b1);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p0_r1, h.p0_g1, h.p0_b1);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p0_r1, h.p0_g1, h.p0_b1);
     } else {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p0_r2, h.p0_g2, h.p0_b2);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p0_r2, h.p0_g2, h.p0_b2);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p0_r2, h.p0_g2, h.p0_b2);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p0_r2, h.p0_g2, h.p0_b2);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p0_r2, h.p0_g2, h.p0_b2);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p0_r2, h.p0_g2, h.p0_b2);
     }
   }
   else if (y >= rows_ && y < 2 * rows_) {
     if (y - rows_ < double_rows_) {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p1_r1, h.p1_g1, h.p1_b1);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p1_r1, h.p1_g1, h.p1_b1);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p1_r1, h.p1_g1, h.p1_b1);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p1_r1, h.p1_g1, h.p1_b1);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p1_r1, h.p1_g1, h.p1_b1);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p1_r1, h.p1_g1, h.p1_b1);
     } else {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p1_r2, h.p1_g2, h.p1_b2);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p1_r2, h.p1_g2, h.p1_b2);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p1_r2, h.p1_g2, h.p1_b2);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p1_r2, h.p1_g2, h.p1_b2);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p1_r2, h.p1_g2, h.p1_b2);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p1_r2, h.p1_g2, h.p1_b2);
     }
   }
   else if (y >= 2*rows_ && y < 3 * rows_) {
     if (y - 2*rows_ < double_rows_) {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p2_r1, h.p2_g1, h.p2_b1);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p2_r1, h.p2_g1, h.p2_b1);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p2_r1, h.p2_g1, h.p2_b1);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p2_r1, h.p2_g1, h.p2_b1);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p2_r1, h.p2_g1, h.p2_b1);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p2_r1, h.p2_g1, h.p2_b1);
     } else {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p2_r2, h.p2_g2, h.p2_b2);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p2_r2, h.p2_g2, h.p2_b2);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p2_r2, h.p2_g2, h.p2_b2);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p2_r2, h.p2_g2, h.p2_b2);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p2_r2, h.p2_g2, h.p2_b2);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p2_r2, h.p2_g2, h.p2_b2);
     }
   }
   else if (y >= 3*rows_ && y < 4 * rows_) {
     if (y - 3*rows_ < double_rows_) {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p3_r1, h.p3_g1, h.p3_b1);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p3_r1, h.p3_g1, h.p3_b1);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p3_r1, h.p3_g1, h.p3_b1);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p3_r1, h.p3_g1, h.p3_b1);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p3_r1, h.p3_g1, h.p3_b1);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p3_r1, h.p3_g1, h.p3_b1);
     } else {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p3_r2, h.p3_g2, h.p3_b2);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p3_r2, h.p3_g2, h.p3_b2);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p3_r2, h.p3_g2, h.p3_b2);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p3_r2, h.p3_g2, h.p3_b2);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p3_r2, h.p3_g2, h.p3_b2);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p3_r2, h.p3_g2, h.p3_b2);
     }
   }
   else if (y >= 4*rows_ && y < 5 * rows_){
     if (y - 4*rows_ < double_rows_) {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p4_r1, h.p4_g1, h.p4_b1);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p4_r1, h.p4_g1, h.p4_b1);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p4_r1, h.p4_g1, h.p4_b1);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p4_r1, h.p4_g1, h.p4_b1);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p4_r1, h.p4_g1, h.p4_b1);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p4_r1, h.p4_g1, h.p4_b1);
     } else {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p4_r2, h.p4_g2, h.p4_b2);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p4_r2, h.p4_g2, h.p4_b2);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p4_r2, h.p4_g2, h.p4_b2);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p4_r2, h.p4_g2, h.p4_b2);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p4_r2, h.p4_g2, h.p4_b2);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p4_r2, h.p4_g2, h.p4_b2);
     }
 
   }
   else {
     if (y - 5*rows_ < double_rows_) {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p5_r1, h.p5_g1, h.p5_b1);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p5_r1, h.p5_g1, h.p5_b1);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p5_r1, h.p5_g1, h.p5_b1);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p5_r1, h.p5_g1, h.p5_b1);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p5_r1, h.p5_g1, h.p5_b1);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p5_r1, h.p5_g1, h.p5_b1);
     } else {
-      d->r_bit = GetGpioFromLedSequence('R', seq, h.p5_r2, h.p5_g2, h.p5_b2);
-      d->g_bit = GetGpioFromLedSequence('G', seq, h.p5_r2, h.p5_g2, h.p5_b2);
-      d->b_bit = GetGpioFromLedSequence('B', seq, h.p5_r2, h.p5_g2, h.p5_b2);
+      c.r_bit = GetGpioFromLedSequence('R', seq, h.p5_r2, h.p5_g2, h.p5_b2);
+      c.g_bit = GetGpioFromLedSequence('G', seq, h.p5_r2, h.p5_g2, h.p5_b2);
+      c.b_bit = GetGpioFromLedSequence('B', seq, h.p5_r2, h.p5_g2, h.p5_b2);
     }
   }
 
-  d->mask = ~(d->r_bit | d->g_bit | d->b_bit);
+  c.mask = ~(c.r_bit | c.g_bit | c.b_bit);
+  d->color_bits = (*shared_mapper_)->AddColorBits(c);
 }
 
 void Framebuffer::Serialize(const char **data, size_t *len) const {
@@ -17,6 +17,7 @@
 #include <inttypes.h>
 
 #include "gpio.h"
+#include "thread.h"
 
 #include <assert.h>
 #include <fcntl.h>
@@ -384,6 +385,11 @@ static uint32_t *mmap_bcm_register(off_t register_offset) {
 static bool mmap_all_bcm_registers_once() {
   if (s_GPIO_registers != NULL) return true;  // alrady done.
 
+#ifdef SIMULATE_GPIO
+  // Writes only go to memory; they are traced in the GPIO class.
+  static uint32_t simulated_registers[REGISTER_BLOCK_SIZE / sizeof(uint32_t)];
+  s_GPIO_registers = simulated_registers;
+#else
   // The common GPIO registers.
   s_GPIO_registers = mmap_bcm_register(GPIO_REGISTER_OFFSET);
   if (s_GPIO_registers == NULL) {
@@ -399,6 +405,7 @@ static bool mmap_all_bcm_registers_once() {
   // Hardware pin-pulser. Might fail when run as non-root.
   s_PWM_registers  = mmap_bcm_register(GPIO_PWM_BASE_OFFSET);
   s_CLK_registers  = mmap_bcm_register(GPIO_CLK_BASE_OFFSET);
+#endif
 
   return true;
 }
@@ -470,11 +477,9 @@ private:
   const std::vector<int> nano_specs_;
 };
 
-// Check that 3 shows up in isolcpus
+// Check that some CPU is isolated, which the refresh thread then uses.
 static bool HasIsolCPUs() {
-  char buf[256];
-  ReadTextFileToBuffer(buf, sizeof(buf), "/sys/devices/system/cpu/isolated");
-  return index(buf, '3') != NULL;
+  return GetIsolatedCPUs() != 0;
 }
 
 static void busy_wait_nanos_rpi_1(long nanos);
@@ -826,18 +831,36 @@ private:
   bool triggered_;
 };
 
+#ifdef SIMULATE_GPIO
+// Records the pulses instead of waiting.
+class SimulatedPinPulser : public PinPulser {
+public:
+  SimulatedPinPulser(GPIO *io) : io_(io) {}
+  virtual void SendPulse(int time_spec_number) {
+    io_->TracePulse(time_spec_number);
+  }
+
+private:
+  GPIO *const io_;
+};
+#endif
+
 } // end anonymous namespace
 
 // Public PinPulser factory
 PinPulser *PinPulser::Create(GPIO *io, gpio_bits_t gpio_mask,
                              bool allow_hardware_pulsing,
                              const std::vector<int> &nano_wait_spec) {
+#ifdef SIMULATE_GPIO
+  return new SimulatedPinPulser(io);
+#else
   if (!Timers::Init()) return NULL;
   if (allow_hardware_pulsing && HardwarePinPulser::CanHandle(gpio_mask)) {
     return new HardwarePinPulser(gpio_mask, nano_wait_spec);
   } else {
     return new TimerBasedPinPulser(io, gpio_mask, nano_wait_spec);
   }
+#endif
 }
 
 // For external use, e.g. in the matrix for extra time.
@@ -77,8 +77,22 @@ public:
   // Return if this is appears to be a Pi4
   static bool IsPi4();
 
+#ifdef SIMULATE_GPIO
+  // Built for tests: nothing goes to the hardware. Instead, all writes and
+  // output enable pulses are recorded in order.
+  struct TraceEvent {
+    char op;            // 'S'et bits, 'C'lear bits or 'P'ulse.
+    gpio_bits_t bits;   // For pulses: the time spec number.
+  };
+  std::vector<TraceEvent> *trace() { return &trace_; }
+  void TracePulse(int time_spec_number) {
+    trace_.push_back({'P', static_cast<gpio_bits_t>(time_spec_number)});
+  }
+#endif
+
 private:
   inline void delay() const {
+#ifndef SIMULATE_GPIO
 #if LED_MATRIX_ALLOW_BARRIER_DELAY
     if (slowdown_ == -1) {
         asm volatile("dsb\tst");
@@ -88,6 +102,7 @@ private:
     for (int n = 0; n < slowdown_; n++) {
       *gpio_clr_bits_low_ = 0;
     }
+#endif
   }
 
   inline gpio_bits_t ReadRegisters() const {
@@ -99,6 +114,9 @@ private:
   }
 
   inline void WriteSetBits(gpio_bits_t value) {
+#ifdef SIMULATE_GPIO
+    trace_.push_back({'S', value});
+#endif
     *gpio_set_bits_low_ = static_cast<uint32_t>(value & 0xFFFFFFFF);
 #ifdef ENABLE_WIDE_GPIO_COMPUTE_MODULE
     if (uses_64_bit_)
@@ -107,6 +125,9 @@ private:
   }
 
   inline void WriteClrBits(gpio_bits_t value) {
+#ifdef SIMULATE_GPIO
+    trace_.push_back({'C', value});
+#endif
     *gpio_clr_bits_low_ = static_cast<uint32_t>(value & 0xFFFFFFFF);
 #ifdef ENABLE_WIDE_GPIO_COMPUTE_MODULE
     if (uses_64_bit_)
@@ -130,6 +151,10 @@ private:
   volatile uint32_t *gpio_clr_bits_high_;
   volatile uint32_t *gpio_read_bits_high_;
 #endif
+
+#ifdef SIMULATE_GPIO
+  std::vector<TraceEvent> trace_;
+#endif
 };
 
 // A PinPulser is a utility class that pulses a GPIO pin. There can be various
@@ -16,9 +16,11 @@
 #include "graphics.h"
 #include "utf8-internal.h"
 
+#include <math.h>
 #include <stdlib.h>
 #include <functional>
 #include <algorithm>
+#include <vector>
 
 namespace rgb_matrix {
 bool SetImage(Canvas *c, int canvas_offset_x, int canvas_offset_y,
@@ -66,12 +68,12 @@ bool SetImage(Canvas *c, int canvas_offset_x, int canvas_offset_y,
       buffer += next_row_skip;
     }
   } else {
+    // RGB is our Color layout, so we can hand over entire rows.
+    const int row_width = w - canvas_offset_x;
     for (int y = canvas_offset_y; y < h; ++y) {
-      for (int x = canvas_offset_x; x < w; ++x) {
-        c->SetPixel(x, y, buffer[0], buffer[1], buffer[2]);
-        buffer += 3;
-      }
-      buffer += next_row_skip;
+      c->SetPixels(canvas_offset_x, y, row_width, 1,
+                   reinterpret_cast<const Color*>(buffer));
+      buffer += 3 * row_width + next_row_skip;
     }
   }
   return true;
@@ -117,6 +119,92 @@ int VerticalDrawText(Canvas *c, const Font &font, int x, int y,
   return y - start_y;
 }
 
+namespace {
+// Canvas writing into an RGB buffer.
+class ImageCanvas : public Canvas {
+public:
+  ImageCanvas(int width, int height, Color *pixels)
+    : width_(width), height_(height), pixels_(pixels) {}
+
+  int width() const final { return width_; }
+  int height() const final { return height_; }
+  void SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) final {
+    if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+    pixels_[y * width_ + x] = Color(r, g, b);
+  }
+  void FillRect(int x, int y, int width, int height,
+                uint8_t r, uint8_t g, uint8_t b) final {
+    const int x_end = std::min(x + width, width_);
+    const int y_end = std::min(y + height, height_);
+    x = std::max(x, 0);
+    y = std::max(y, 0);
+    for (int row = y; row < y_end; ++row) {
+      std::fill(pixels_ + row * width_ + x, pixels_ + row * width_ + x_end,
+                Color(r, g, b));
+    }
+  }
+  void Clear() final { Fill(0, 0, 0); }
+  void Fill(uint8_t r, uint8_t g, uint8_t b) final {
+    std::fill(pixels_, pixels_ + width_ * height_, Color(r, g, b));
+  }
+
+private:
+  const int width_;
+  const int height_;
+  Color *const pixels_;
+};
+}  // namespace
+
+TextStrip::TextStrip() : width_(0), height_(0), padding_(0) {}
+
+int TextStrip::SetText(const Font &font, const char *utf8_text,
+                       const Color &color, const Color &background_color,
+                       int kerning_offset,
+                       const Font *outline_font, const Color &outline_color) {
+  // Measure on an empty canvas: glyphs are skipped, but still advance.
+  ImageCanvas measure(0, 0, NULL);
+  const int length = DrawText(&measure, font, 0, 0, color, NULL,
+                              utf8_text, kerning_offset);
+  padding_ = outline_font ? 1 : 0;
+  width_ = std::max(length, 0) + 2 * padding_;
+  height_ = font.height() + 2 * padding_;
+  pixels_.resize(width_ * height_);
+
+  ImageCanvas strip(width_, height_, pixels_.data());
+  strip.Fill(background_color.r, background_color.g, background_color.b);
+  const int baseline = font.baseline() + padding_;
+  if (outline_font) {
+    // Same letter pitch as the regular text we then write on top.
+    DrawText(&strip, *outline_font, 0, baseline, outline_color, NULL,
+             utf8_text, kerning_offset - 2);
+  }
+  DrawText(&strip, font, padding_, baseline, color, NULL,
+           utf8_text, kerning_offset);
+  return length;
+}
+
+void TextStrip::Draw(Canvas *c, int x, int y) const {
+  DrawColumns(c, x, y, 0, c->width());
+}
+
+void TextStrip::DrawColumns(Canvas *c, int x, int y,
+                            int clip_x, int clip_width) const {
+  x -= padding_;
+  y -= padding_;
+  // Only the part that is visible on the canvas.
+  clip_x = std::max(clip_x, 0);
+  const int clip_end = std::min(clip_x + clip_width, c->width());
+  const int first_col = std::max(0, clip_x - x);
+  const int last_col = std::min(width_, clip_end - x);
+  const int first_row = std::max(0, -y);
+  const int last_row = std::min(height_, c->height() - y);
+  if (first_col >= last_col) return;
+  for (int row = first_row; row < last_row; ++row) {
+    c->SetPixels(x + first_col, y + row, last_col - first_col, 1,
+                 &pixels_[row * width_ + first_col]);
+  }
+}
+
 void DrawCircle(Canvas *c, int x0, int y0, int radius, const Color &color) {
   int x = radius, y = 0;
   int radiusError = 1 - x;
@@ -169,4 +257,68 @@ void DrawLine(Canvas *c, int x0, int y0, int x1, int y1, const Color &color) {
   }
 }
 
+void FillRect(Canvas *c, int x, int y, int width, int height,
+              const Color &color) {
+  if (width <= 0 || height <= 0) return;
+  c->FillRect(x, y, width, height, color.r, color.g, color.b);
+}
+
+void FillHorizontalSpan(Canvas *c, int x0, int x1, int y, const Color &color) {
+  if (x1 < x0) std::swap(x0, x1);
+  c->FillRect(x0, y, x1 - x0 + 1, 1, color.r, color.g, color.b);
+}
+
+void FillVerticalSpan(Canvas *c, int x, int y0, int y1, const Color &color) {
+  if (y1 < y0) std::swap(y0, y1);
+  c->FillRect(x, y0, 1, y1 - y0 + 1, color.r, color.g, color.b);
+}
+
+void FillCircle(Canvas *c, int x0, int y0, int radius, const Color &color) {
+  // Same midpoint algorithm as DrawCircle(), but filling the span between
+  // each pair of mirrored points.
+  int x = radius, y = 0;
+  int radiusError = 1 - x;
+
+  while (y <= x) {
+    FillHorizontalSpan(c, x0 - x, x0 + x, y0 + y, color);
+    FillHorizontalSpan(c, x0 - x, x0 + x, y0 - y, color);
+    FillHorizontalSpan(c, x0 - y, x0 + y, y0 + x, color);
+    FillHorizontalSpan(c, x0 - y, x0 + y, y0 - x, color);
+    y++;
+    if (radiusError<0){
+      radiusError += 2 * y + 1;
+    } else {
+      x--;
+      radiusError+= 2 * (y - x + 1);
+    }
+  }
+}
+
+void FillPolygon(Canvas *c, const int *xs, const int *ys, int count,
+                 const Color &color) {
+  if (count < 3) return;
+  const int y_min = std::max(*std::min_element(ys, ys + count), 0);
+  const int y_max = std::min(*std::max_element(ys, ys + count),
+                             c->height() - 1);
+  std::vector<int> crossings;
+  for (int y = y_min; y <= y_max; ++y) {
+    // Sample at the pixel center, so that vertices are never hit exactly.
+    const float sample_y = y + 0.5f;
+    crossings.clear();
+    for (int i = 0, j = count - 1; i < count; j = i++) {
+      if ((ys[j] <= y) == (ys[i] <= y))
+        continue;   // Edge does not cross this row.
+      const float x = xs[j] + (float)(xs[i] - xs[j]) * (sample_y - ys[j])
+        / (ys[i] - ys[j]);
+      // First pixel whose center is right of the crossing.
+      crossings.push_back((int)ceilf(x - 0.5f));
+    }
+    std::sort(crossings.begin(), crossings.end());
+    for (size_t k = 0; k + 1 < crossings.size(); k += 2) {
+      if (crossings[k + 1] > crossings[k])
+        FillHorizontalSpan(c, crossings[k], crossings[k + 1] - 1, y, color);
+    }
+  }
+}
+
 }//namespace
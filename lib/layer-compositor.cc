@@ -0,0 +1,198 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+#include "layer-compositor.h"
+
+#include <algorithm>
+
+namespace rgb_matrix {
+Layer::Layer(int width, int height, BlendMode mode, uint8_t opacity)
+  : width_(width), height_(height), mode_(mode), opacity_(opacity),
+    visible_(true), changed_(true), pixels_(width * height) {
+}
+
+void Layer::set_opacity(uint8_t opacity) {
+  if (opacity != opacity_) changed_ = true;
+  opacity_ = opacity;
+}
+
+void Layer::set_blend_mode(BlendMode mode) {
+  if (mode != mode_) changed_ = true;
+  mode_ = mode;
+}
+
+void Layer::set_visible(bool visible) {
+  if (visible != visible_) changed_ = true;
+  visible_ = visible;
+}
+
+void Layer::SetPixelRGBA(int x, int y, const RGBAColor &color) {
+  if (x < 0 || x >= width_ || y < 0 || y >= height_) return;
+  pixels_[y * width_ + x] = color;
+  changed_ = true;
+}
+
+void Layer::SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) {
+  SetPixelRGBA(x, y, RGBAColor(red, green, blue));
+}
+
+void Layer::SetPixels(int x, int y, int width, int height,
+                      const Color *colors) {
+  const int stride = width;
+  if (x < 0) { colors -= x; width += x; x = 0; }
+  if (y < 0) { colors -= y * stride; height += y; y = 0; }
+  if (x + width > width_) width = width_ - x;
+  if (y + height > height_) height = height_ - y;
+  if (width <= 0 || height <= 0) return;
+  for (int row = 0; row < height; ++row, colors += stride) {
+    RGBAColor *dest = &pixels_[(y + row) * width_ + x];
+    for (int col = 0; col < width; ++col) {
+      dest[col] = RGBAColor(colors[col].r, colors[col].g, colors[col].b);
+    }
+  }
+  changed_ = true;
+}
+
+void Layer::FillRect(int x, int y, int width, int height,
+                     uint8_t red, uint8_t green, uint8_t blue) {
+  const int x_end = std::min(x + width, width_);
+  const int y_end = std::min(y + height, height_);
+  x = std::max(x, 0);
+  y = std::max(y, 0);
+  if (x >= x_end || y >= y_end) return;
+  for (int row = y; row < y_end; ++row) {
+    std::fill(&pixels_[row * width_ + x], &pixels_[row * width_ + x_end],
+              RGBAColor(red, green, blue));
+  }
+  changed_ = true;
+}
+
+void Layer::Clear() {
+  std::fill(pixels_.begin(), pixels_.end(), RGBAColor());
+  changed_ = true;
+}
+
+void Layer::Fill(uint8_t red, uint8_t green, uint8_t blue) {
+  std::fill(pixels_.begin(), pixels_.end(), RGBAColor(red, green, blue));
+  changed_ = true;
+}
+
+LayerCompositor::LayerCompositor(int width, int height)
+  : width_(width), height_(height),
+    cache_(width * height), cached_layers_(0), cache_valid_(false),
+    result_(width * height) {
+}
+
+LayerCompositor::~LayerCompositor() {
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    delete layers_[i];
+  }
+}
+
+Layer *LayerCompositor::AddLayer(Layer::BlendMode mode, uint8_t opacity) {
+  Layer *layer = new Layer(width_, height_, mode, opacity);
+  layers_.push_back(layer);
+  return layer;
+}
+
+// Approximation of (v / 255) for v in [0, 255*255], exact after rounding.
+static inline uint32_t Div255(uint32_t v) {
+  v += 128;
+  return (v + (v >> 8)) >> 8;
+}
+
+// The blend functions are kept simple and branch-free so that the compiler
+// can vectorize the loops below (e.g. NEON on the Pi with -O3).
+struct BlendNormal {
+  static inline uint32_t Mix(uint32_t dst, uint32_t src) { return src; }
+};
+struct BlendAdd {
+  static inline uint32_t Mix(uint32_t dst, uint32_t src) {
+    return std::min(dst + src, 255u);
+  }
+};
+struct BlendMultiply {
+  static inline uint32_t Mix(uint32_t dst, uint32_t src) {
+    return Div255(dst * src);
+  }
+};
+struct BlendScreen {
+  static inline uint32_t Mix(uint32_t dst, uint32_t src) {
+    return 255 - Div255((255 - dst) * (255 - src));
+  }
+};
+
+// Blend the mixed color over the destination with the pixel alpha
+// scaled by the layer opacity.
+template <class Mode>
+static void BlendPixels(const RGBAColor *src, Color *dest, int count,
+                        uint32_t opacity) {
+  for (int i = 0; i < count; ++i) {
+    const uint32_t alpha = Div255(src[i].a * opacity);
+    const uint32_t r = Mode::Mix(dest[i].r, src[i].r);
+    const uint32_t g = Mode::Mix(dest[i].g, src[i].g);
+    const uint32_t b = Mode::Mix(dest[i].b, src[i].b);
+    dest[i].r = Div255(dest[i].r * (255 - alpha) + r * alpha);
+    dest[i].g = Div255(dest[i].g * (255 - alpha) + g * alpha);
+    dest[i].b = Div255(dest[i].b * (255 - alpha) + b * alpha);
+  }
+}
+
+void LayerCompositor::Blend(const Layer &layer, Color *dest) const {
+  if (!layer.visible_ || layer.opacity_ == 0) return;
+  const RGBAColor *src = layer.pixels_.data();
+  const int count = width_ * height_;
+  switch (layer.mode_) {
+  case Layer::BLEND_NORMAL:
+    BlendPixels<BlendNormal>(src, dest, count, layer.opacity_);
+    break;
+  case Layer::BLEND_ADD:
+    BlendPixels<BlendAdd>(src, dest, count, layer.opacity_);
+    break;
+  case Layer::BLEND_MULTIPLY:
+    BlendPixels<BlendMultiply>(src, dest, count, layer.opacity_);
+    break;
+  case Layer::BLEND_SCREEN:
+    BlendPixels<BlendScreen>(src, dest, count, layer.opacity_);
+    break;
+  }
+}
+
+void LayerCompositor::Render(Canvas *canvas, int x, int y) {
+  // All layers below the first changed one are the same as last time.
+  size_t first_changed = 0;
+  while (first_changed < layers_.size() && !layers_[first_changed]->changed_)
+    ++first_changed;
+
+  // Keep those in the cache, so that only the layers from the first
+  // changed one upwards need to be blended.
+  if (!cache_valid_ || cached_layers_ != first_changed) {
+    std::fill(cache_.begin(), cache_.end(), Color());
+    for (size_t i = 0; i < first_changed; ++i) {
+      Blend(*layers_[i], cache_.data());
+    }
+    cached_layers_ = first_changed;
+    cache_valid_ = true;
+  }
+
+  result_ = cache_;
+  for (size_t i = first_changed; i < layers_.size(); ++i) {
+    Blend(*layers_[i], result_.data());
+    layers_[i]->changed_ = false;
+  }
+
+  canvas->SetPixels(x, y, width_, height_, result_.data());
+}
+}  // namespace rgb_matrix
@@ -89,6 +89,8 @@ static struct RGBLedMatrix *led_matrix_create_from_options_optional_edit(
     OPT_COPY_IF_SET(panel_type);
     OPT_COPY_IF_SET(limit_refresh_rate_hz);
     OPT_COPY_IF_SET(disable_busy_waiting);
+    OPT_COPY_IF_SET(refresh_priority);
+    OPT_COPY_IF_SET(refresh_cpu);
 #undef OPT_COPY_IF_SET
   }
 
@@ -136,6 +138,8 @@ static struct RGBLedMatrix *led_matrix_create_from_options_optional_edit(
     ACTUAL_VALUE_BACK_TO_OPT(panel_type);
     ACTUAL_VALUE_BACK_TO_OPT(limit_refresh_rate_hz);
     ACTUAL_VALUE_BACK_TO_OPT(disable_busy_waiting);
+    ACTUAL_VALUE_BACK_TO_OPT(refresh_priority);
+    ACTUAL_VALUE_BACK_TO_OPT(refresh_cpu);
 #undef ACTUAL_VALUE_BACK_TO_OPT
   }
 
@@ -207,6 +211,14 @@ struct LedCanvas *led_matrix_swap_on_vsync(struct RGBLedMatrix *matrix,
   return from_canvas(to_matrix(matrix)->SwapOnVSync(to_canvas(canvas)));
 }
 
+struct LedCanvas *led_matrix_swap_on_vsync_rgb(struct RGBLedMatrix *matrix,
+                                               struct LedCanvas *canvas,
+                                               const uint8_t *rgb, int stride) {
+  rgb_matrix::FrameCanvas *const c = to_canvas(canvas);
+  led_canvas_set_pixels_rgb(canvas, 0, 0, c->width(), c->height(), rgb, stride);
+  return from_canvas(to_matrix(matrix)->SwapOnVSync(c));
+}
+
 void led_matrix_set_brightness(struct RGBLedMatrix *matrix,
                                uint8_t brightness) {
   to_matrix(matrix)->SetBrightness(brightness);
@@ -234,6 +246,20 @@ void led_canvas_set_pixels(struct LedCanvas *canvas, int x, int y,
   to_canvas(canvas)->SetPixels(x, y, width, height, to_color(colors));
 }
 
+void led_canvas_set_pixels_rgb(struct LedCanvas *canvas, int x, int y,
+                               int width, int height,
+                               const uint8_t *rgb, int stride) {
+  // rgb triplets have the memory layout of Color.
+  rgb_matrix::FrameCanvas *const c = to_canvas(canvas);
+  if (stride == width * 3) {
+    c->SetPixels(x, y, width, height, (const rgb_matrix::Color*)rgb);
+    return;
+  }
+  for (int row = 0; row < height; ++row, rgb += stride) {
+    c->SetPixels(x, y + row, width, 1, (const rgb_matrix::Color*)rgb);
+  }
+}
+
 void led_canvas_clear(struct LedCanvas *canvas) {
   to_canvas(canvas)->Clear();
 }
@@ -242,6 +268,32 @@ void led_canvas_fill(struct LedCanvas *canvas, uint8_t r, uint8_t g, uint8_t b)
   to_canvas(canvas)->Fill(r, g, b);
 }
 
+void led_canvas_fill_rect(struct LedCanvas *canvas, int x, int y,
+                          int width, int height,
+                          uint8_t r, uint8_t g, uint8_t b) {
+  to_canvas(canvas)->FillRect(x, y, width, height, r, g, b);
+}
+
+void led_canvas_fill_spans(struct LedCanvas *canvas,
+                           const struct LedSpan *spans, int count) {
+  rgb_matrix::FrameCanvas *const c = to_canvas(canvas);
+  for (int i = 0; i < count; ++i) {
+    const struct LedSpan &s = spans[i];
+    c->FillRect(s.x, s.y, s.length, 1, s.color.r, s.color.g, s.color.b);
+  }
+}
+
+void led_canvas_blit(struct LedCanvas *dst, const struct LedCanvas *src,
+                     int src_x, int src_y, int width, int height,
+                     int dst_x, int dst_y) {
+  to_canvas(dst)->Blit(*reinterpret_cast<const rgb_matrix::FrameCanvas*>(src),
+                       src_x, src_y, width, height, dst_x, dst_y);
+}
+
+void led_canvas_scroll(struct LedCanvas *canvas, int dx, int dy) {
+  to_canvas(canvas)->ScrollBy(dx, dy);
+}
+
 struct LedFont *load_font(const char *bdf_font_file) {
   rgb_matrix::Font* font = new rgb_matrix::Font();
   font->LoadFont(bdf_font_file);
@@ -305,6 +357,20 @@ int vertical_draw_text(struct LedCanvas *c, struct LedFont *font, int x, int y,
   return VerticalDrawText(to_canvas(c), *to_font(font), x, y, col, NULL, utf8_text, kerning_offset);
 }
 
+void draw_texts(struct LedCanvas *c, const struct LedText *texts, int count,
+                int *advances) {
+  for (int i = 0; i < count; ++i) {
+    const struct LedText &t = texts[i];
+    const rgb_matrix::Color col(t.color.r, t.color.g, t.color.b);
+    const int advance = t.vertical
+      ? VerticalDrawText(to_canvas(c), *to_font(t.font), t.x, t.y, col, NULL,
+                         t.utf8_text, t.kerning_offset)
+      : DrawText(to_canvas(c), *to_font(t.font), t.x, t.y, col, NULL,
+                 t.utf8_text, t.kerning_offset);
+    if (advances) advances[i] = advance;
+  }
+}
+
 // Draw a circle centered at "x", "y", with a radius of "radius" and with "color"
 void draw_circle(struct LedCanvas *c, int xx, int y, int radius, uint8_t r, uint8_t g, uint8_t b) {
   const rgb_matrix::Color col = rgb_matrix::Color( r,g,b );
@@ -29,6 +29,9 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+
 #include "gpio.h"
 #include "thread.h"
 #include "framebuffer-internal.h"
@@ -89,6 +92,7 @@ public:
 
   uint64_t RequestInputs(uint64_t);
   uint64_t AwaitInputChange(int timeout_ms);
+  int ReadInputEvents(GPIOInputEvent *events, int max_events);
 
   uint64_t RequestOutputs(uint64_t output_bits);
   void OutputGPIO(uint64_t output_bits);
@@ -96,21 +100,14 @@ public:
 private:
   friend class RGBMatrix;
 
-  // Apply pixel mappers that have been passed down via a configuration
-  // string.
-  void ApplyNamedPixelMappers(const char *pixel_mapper_config,
-                              int chain, int parallel);
-
-  Options params_;
-  bool do_luminance_correct_;
+  FrameCanvasFactory canvases_;
+  Options &params_;  // Shared with canvases_.
 
   FrameCanvas *active_;
 
   GPIO *io_;
   Mutex active_frame_sync_;
   UpdateThread *updater_;
-  std::vector<FrameCanvas*> created_frames_;
-  internal::PixelDesignatorMap *shared_pixel_mapper_;
   uint64_t user_output_bits_;
 };
 
@@ -125,7 +122,7 @@ public:
     : io_(io), show_refresh_(show_refresh),
       target_frame_usec_(limit_refresh_hz < 1 ? 0 : 1e6/limit_refresh_hz),
       allow_busy_waiting_(allow_busy_waiting),
-      running_(true),
+      running_(true), input_write_pos_(0), input_read_pos_(0),
       current_frame_(initial_frame), next_frame_(NULL),
       requested_frame_multiple_(1) {
     pthread_cond_init(&frame_done_, NULL);
@@ -190,6 +187,7 @@ public:
       const gpio_bits_t inputs = io_->Read();
       if (inputs != last_gpio_bits) {
         last_gpio_bits = inputs;
+        AddInputEvent(inputs);
         MutexLock l(&input_sync_);
         gpio_inputs_ = inputs;
         pthread_cond_signal(&input_change_);
@@ -241,7 +239,41 @@ public:
     return gpio_inputs_;
   }
 
+  // Consumer side of the input event ring.
+  int ReadInputEvents(GPIOInputEvent *events, int max_events) {
+    const uint32_t read_pos = input_read_pos_.load(std::memory_order_relaxed);
+    const uint32_t available
+      = input_write_pos_.load(std::memory_order_acquire) - read_pos;
+    const int count = std::min((int)available, max_events);
+    for (int i = 0; i < count; ++i) {
+      events[i] = input_events_[(read_pos + i) % kInputEventCount];
+    }
+    input_read_pos_.store(read_pos + count, std::memory_order_release);
+    return count;
+  }
+
 private:
+  // Size of the input event ring. Power of two, so that the positions can
+  // wrap around.
+  static constexpr uint32_t kInputEventCount = 256;
+
+  // Producer side of the input event ring. Lock-free, so that the refresh
+  // never waits for a reader.
+  void AddInputEvent(gpio_bits_t inputs) {
+    const uint32_t write_pos
+      = input_write_pos_.load(std::memory_order_relaxed);
+    if (write_pos - input_read_pos_.load(std::memory_order_acquire)
+        >= kInputEventCount) {
+      return;  // Full. Reader did not keep up.
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    GPIOInputEvent *event = &input_events_[write_pos % kInputEventCount];
+    event->timestamp_usec = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    event->bits = inputs;
+    input_write_pos_.store(write_pos + 1, std::memory_order_release);
+  }
+
   inline bool running() {
     MutexLock l(&running_mutex_);
     return running_;
@@ -260,6 +292,10 @@ private:
   pthread_cond_t input_change_;
   gpio_bits_t gpio_inputs_;
 
+  GPIOInputEvent input_events_[kInputEventCount];
+  std::atomic<uint32_t> input_write_pos_;
+  std::atomic<uint32_t> input_read_pos_;
+
   Mutex frame_sync_;
   pthread_cond_t frame_done_;
   FrameCanvas *current_frame_;
@@ -325,10 +361,12 @@ RGBMatrix::Options::Options() :
   limit_refresh_rate_hz(0),
 #endif
 #ifdef DISABLE_BUSY_WAITING
-    disable_busy_waiting(true)
+    disable_busy_waiting(true),
 #else
-    disable_busy_waiting(false)
+    disable_busy_waiting(false),
 #endif
+  refresh_priority(99),
+  refresh_cpu(-1)
 {
   // Nothing to see here.
 }
@@ -360,6 +398,8 @@ static void PrintOptions(const RGBMatrix::Options &o) {
   P_STR(panel_type);
   P_INT(limit_refresh_rate_hz);
   P_BOOL(disable_busy_waiting);
+  P_INT(refresh_priority);
+  P_INT(refresh_cpu);
 #undef P_INT
 #undef P_STR
 #undef P_BOOL
@@ -367,39 +407,14 @@ static void PrintOptions(const RGBMatrix::Options &o) {
 #endif  // DEBUG_MATRIX_OPTIONS
 
 RGBMatrix::Impl::Impl(GPIO *io, const Options &options)
-  : params_(options), io_(NULL), updater_(NULL), shared_pixel_mapper_(NULL),
+  : canvases_(options), params_(canvases_.options_), io_(NULL), updater_(NULL),
     user_output_bits_(0) {
-  assert(params_.Validate(NULL));
 #if DEBUG_MATRIX_OPTIONS
   PrintOptions(params_);
 #endif
-  const MultiplexMapper *multiplex_mapper = NULL;
-  if (params_.multiplexing > 0) {
-    const MuxMapperList &multiplexers = GetRegisteredMultiplexMappers();
-    if (params_.multiplexing <= (int) multiplexers.size()) {
-      // TODO: we could also do a find-by-name here, but not sure if worthwhile
-      multiplex_mapper = multiplexers[params_.multiplexing - 1];
-    }
-  }
-
-  if (multiplex_mapper) {
-    // The multiplexers might choose to have a different physical layout.
-    // We need to configure that first before setting up the hardware.
-    multiplex_mapper->EditColsRows(&params_.cols, &params_.rows);
-  }
-
-  Framebuffer::InitHardwareMapping(params_.hardware_mapping);
-
   active_ = CreateFrameCanvas();
   active_->Clear();
   SetGPIO(io, true);
-
-  // We need to apply the mapping for the panels first.
-  ApplyPixelMapper(multiplex_mapper);
-
-  // .. followed by higher level mappers that might arrange panels.
-  ApplyNamedPixelMappers(options.pixel_mapper_config,
-                         params_.chain_length, params_.parallel);
 }
 
 RGBMatrix::Impl::~Impl() {
@@ -412,11 +427,6 @@ RGBMatrix::Impl::~Impl() {
   // Make sure LEDs are off.
   active_->Clear();
   if (io_) active_->framebuffer()->DumpToMatrix(io_, 0);
-
-  for (size_t i = 0; i < created_frames_.size(); ++i) {
-    delete created_frames_[i];
-  }
-  delete shared_pixel_mapper_;
 }
 
 RGBMatrix::~RGBMatrix() {
@@ -437,39 +447,15 @@ void RGBMatrix::Impl::OutputGPIO(uint64_t output_bits) {
   io_->WriteMaskedBits(static_cast<gpio_bits_t>(output_bits), static_cast<gpio_bits_t>(user_output_bits_));
 }
 
-void RGBMatrix::Impl::ApplyNamedPixelMappers(const char *pixel_mapper_config,
-                                             int chain, int parallel) {
-  if (pixel_mapper_config == NULL || strlen(pixel_mapper_config) == 0)
-    return;
-  char *const writeable_copy = strdup(pixel_mapper_config);
-  const char *const end = writeable_copy + strlen(writeable_copy);
-  char *s = writeable_copy;
-  while (s < end) {
-    char *const semicolon = strchrnul(s, ';');
-    *semicolon = '\0';
-    char *optional_param_start = strchr(s, ':');
-    if (optional_param_start) {
-      *optional_param_start++ = '\0';
-    }
-    if (*s == '\0' && optional_param_start && *optional_param_start != '\0') {
-      fprintf(stderr, "Stray parameter ':%s' without mapper name ?\n", optional_param_start);
-    }
-    if (*s) {
-      ApplyPixelMapper(FindPixelMapper(s, chain, parallel, optional_param_start));
-    }
-    s = semicolon + 1;
-  }
-  free(writeable_copy);
-}
-
 void RGBMatrix::Impl::SetGPIO(GPIO *io, bool start_thread) {
   if (io != NULL && io_ == NULL) {
     io_ = io;
-    Framebuffer::InitGPIO(io_, params_.rows, params_.parallel,
+    const struct HardwareMapping &h = active_->framebuffer()->hardware_mapping();
+    Framebuffer::InitGPIO(io_, h, params_.rows, params_.parallel,
                           !params_.disable_hardware_pulsing,
                           params_.pwm_lsb_nanoseconds, params_.pwm_dither_bits,
                           params_.row_address_type);
-    Framebuffer::InitializePanels(io_, params_.panel_type,
+    Framebuffer::InitializePanels(io_, h, params_.panel_type,
                                   params_.cols * params_.chain_length);
   }
   if (start_thread) {
@@ -477,58 +463,43 @@ void RGBMatrix::Impl::SetGPIO(GPIO *io, bool start_thread) {
   }
 }
 
+// CPU the refresh thread should run on for the --led-refresh-cpu option
+// "requested"; -1 if it should not be tied to any.
+static int ChooseRefreshCPU(int requested) {
+  if (requested >= 0) return requested;
+  // If we have multiple processors, the kernel jumps around between these,
+  // creating some global flicker. So let's tie it to an isolated CPU
+  // which nothing else uses, or at least the last CPU available (which
+  // the kernel tends to use least).
+  const uint32_t isolated = GetIsolatedCPUs();
+  for (int cpu = 31; cpu >= 0; --cpu) {
+    if (isolated & (1u << cpu)) return cpu;
+  }
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus <= 1) return -1;  // Pi1: only one core, nothing to choose.
+  return std::min(cpus - 1, 31L);
+}
+
 bool RGBMatrix::Impl::StartRefresh() {
   if (updater_ == NULL && io_ != NULL) {
     updater_ = new UpdateThread(io_, active_, params_.pwm_dither_bits,
                                 params_.show_refresh_rate,
                                 params_.limit_refresh_rate_hz,
                                 !params_.disable_busy_waiting);
-    // If we have multiple processors, the kernel
-    // jumps around between these, creating some global flicker.
-    // So let's tie it to the last CPU available.
-    // The Raspberry Pi2 has 4 cores, our attempt to bind it to
-    //   core #3 will succeed.
-    // The Raspberry Pi1 only has one core, so this affinity
-    //   call will simply fail and we keep using the only core.
-    updater_->Start(99, (1<<3));  // Prio: high. Also: put on last CPU.
+    const int cpu = ChooseRefreshCPU(params_.refresh_cpu);
+    if (cpu >= 0) {
+      // Keep our own threads, e.g. audio capture or image decoding, from
+      // competing with the refresh for that CPU. The refresh thread itself
+      // is explicitly tied to it below.
+      KeepThreadsOffCPU(cpu);
+    }
+    updater_->Start(params_.refresh_priority, cpu >= 0 ? (1u << cpu) : 0);
   }
   return updater_ != NULL;
 }
 
 FrameCanvas *RGBMatrix::Impl::CreateFrameCanvas() {
-  FrameCanvas *result =
-    new FrameCanvas(new Framebuffer(params_.rows,
-                                    params_.cols * params_.chain_length,
-                                    params_.parallel,
-                                    params_.scan_mode,
-                                    params_.led_rgb_sequence,
-                                    params_.inverse_colors,
-                                    &shared_pixel_mapper_));
-  if (created_frames_.empty()) {
-    // First time. Get defaults from initial Framebuffer.
-    do_luminance_correct_ = result->framebuffer()->luminance_correct();
-  }
-
-  result->framebuffer()->SetPWMBits(params_.pwm_bits);
-  result->framebuffer()->set_luminance_correct(do_luminance_correct_);
-  result->framebuffer()->SetBrightness(params_.brightness);
-
-  created_frames_.push_back(result);
-
-  if (created_frames_.size() % 500 == 0) {
-    if (created_frames_.size() == 500) {
-      fprintf(stderr, "CreateFrameCanvas() called %d times; Usually you only want to call it once (or at most a few times) for double-buffering. These frames will not be freed until the end of the program.\n"
-              "Typical reasons: \n"
-              "  * Accidentally called CreateFrameCanvas() inside your inner loop (move outside the loop. Create offscreen-canvas once, then re-use. See SwapOnVSync() examples).\n"
-              "  * Used to pre-compute many frames (use led_matrix::StreamWriter instead for such use-case. See e.g. led-image-viewer)\n",
-              (int)created_frames_.size());
-    } else {
-      fprintf(stderr, "FYI: CreateFrameCanvas() now called %d times.\n",
-              (int)created_frames_.size());
-    }
-  }
-
-  return result;
+  return canvases_.CreateFrameCanvas();
 }
 
 FrameCanvas *RGBMatrix::Impl::SwapOnVSync(FrameCanvas *other,
@@ -545,6 +516,11 @@ uint64_t RGBMatrix::Impl::AwaitInputChange(int timeout_ms) {
   return updater_->AwaitInputChange(timeout_ms);
 }
 
+int RGBMatrix::Impl::ReadInputEvents(GPIOInputEvent *events, int max_events) {
+  if (!updater_ || max_events <= 0) return 0;
+  return updater_->ReadInputEvents(events, max_events);
+}
+
 bool RGBMatrix::Impl::SetPWMBits(uint8_t value) {
   const bool success = active_->framebuffer()->SetPWMBits(value);
   if (success) {
@@ -557,17 +533,14 @@ uint8_t RGBMatrix::Impl::pwmbits() { return params_.pwm_bits; }
 // Map brightness of output linearly to input with CIE1931 profile.
 void RGBMatrix::Impl::set_luminance_correct(bool on) {
   active_->framebuffer()->set_luminance_correct(on);
-  do_luminance_correct_ = on;
+  canvases_.set_luminance_correct(on);
 }
 bool RGBMatrix::Impl::luminance_correct() const {
-  return do_luminance_correct_;
+  return canvases_.luminance_correct_;
 }
 
 void RGBMatrix::Impl::SetBrightness(uint8_t brightness) {
-  for (size_t i = 0; i < created_frames_.size(); ++i) {
-    created_frames_[i]->framebuffer()->SetBrightness(brightness);
-  }
-  params_.brightness = brightness;
+  canvases_.SetBrightness(brightness);
 }
 
 uint8_t RGBMatrix::Impl::brightness() {
@@ -575,6 +548,131 @@ uint8_t RGBMatrix::Impl::brightness() {
 }
 
 bool RGBMatrix::Impl::ApplyPixelMapper(const PixelMapper *mapper) {
+  return canvases_.ApplyPixelMapper(mapper);
+}
+
+// -- FrameCanvasFactory: the canvases and their pixel mapping, shared by
+// RGBMatrix and offscreen use.
+
+FrameCanvasFactory *FrameCanvasFactory::Create(
+  const RGBMatrix::Options &options) {
+  std::string error;
+  if (!options.Validate(&error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return NULL;
+  }
+  return new FrameCanvasFactory(options);
+}
+
+FrameCanvasFactory::FrameCanvasFactory(const RGBMatrix::Options &options)
+  : options_(options), luminance_correct_(true), unused_frame_(NULL),
+    shared_pixel_mapper_(NULL) {
+  assert(options_.Validate(NULL));
+  const MultiplexMapper *multiplex_mapper = NULL;
+  if (options_.multiplexing > 0) {
+    const MuxMapperList &multiplexers = GetRegisteredMultiplexMappers();
+    if (options_.multiplexing <= (int) multiplexers.size()) {
+      // TODO: we could also do a find-by-name here, but not sure if worthwhile
+      multiplex_mapper = multiplexers[options_.multiplexing - 1];
+    }
+  }
+
+  if (multiplex_mapper) {
+    // The multiplexers might choose to have a different physical layout.
+    // We need to configure that first before setting up the hardware.
+    multiplex_mapper->EditColsRows(&options_.cols, &options_.rows);
+  }
+
+  // The first Framebuffer sets up the mapping of the physical panels. Keep
+  // it for the first CreateFrameCanvas().
+  unused_frame_ = CreateFrameCanvas();
+
+  // We need to apply the mapping for the panels first.
+  ApplyPixelMapper(multiplex_mapper);
+
+  // .. followed by higher level mappers that might arrange panels.
+  ApplyNamedPixelMappers(options.pixel_mapper_config,
+                         options_.chain_length, options_.parallel);
+}
+
+FrameCanvasFactory::~FrameCanvasFactory() {
+  for (size_t i = 0; i < created_frames_.size(); ++i) {
+    delete created_frames_[i];
+  }
+  delete shared_pixel_mapper_;
+}
+
+int FrameCanvasFactory::width() const { return shared_pixel_mapper_->width(); }
+int FrameCanvasFactory::height() const { return shared_pixel_mapper_->height(); }
+
+void FrameCanvasFactory::SetBrightness(uint8_t brightness) {
+  for (size_t i = 0; i < created_frames_.size(); ++i) {
+    created_frames_[i]->framebuffer()->SetBrightness(brightness);
+  }
+  options_.brightness = brightness;
+}
+
+FrameCanvas *FrameCanvasFactory::CreateFrameCanvas() {
+  FrameCanvas *result = unused_frame_;
+  unused_frame_ = NULL;
+  if (result == NULL) {
+    result = new FrameCanvas(
+      new Framebuffer(options_.rows, options_.cols * options_.chain_length,
+                      options_.parallel, options_.scan_mode,
+                      options_.led_rgb_sequence, options_.inverse_colors,
+                      Framebuffer::FindHardwareMapping(options_.hardware_mapping),
+                      &shared_pixel_mapper_));
+    if (created_frames_.empty()) {
+      // First time. Get defaults from initial Framebuffer.
+      luminance_correct_ = result->framebuffer()->luminance_correct();
+    }
+    created_frames_.push_back(result);
+    if (created_frames_.size() % 500 == 0) {
+      if (created_frames_.size() == 500) {
+        fprintf(stderr, "CreateFrameCanvas() called %d times; Usually you only want to call it once (or at most a few times) for double-buffering. These frames will not be freed until the end of the program.\n"
+                "Typical reasons: \n"
+                "  * Accidentally called CreateFrameCanvas() inside your inner loop (move outside the loop. Create offscreen-canvas once, then re-use. See SwapOnVSync() examples).\n"
+                "  * Used to pre-compute many frames (use led_matrix::StreamWriter instead for such use-case. See e.g. led-image-viewer)\n",
+                (int)created_frames_.size());
+      } else {
+        fprintf(stderr, "FYI: CreateFrameCanvas() now called %d times.\n",
+                (int)created_frames_.size());
+      }
+    }
+  }
+
+  result->framebuffer()->SetPWMBits(options_.pwm_bits);
+  result->framebuffer()->set_luminance_correct(luminance_correct_);
+  result->framebuffer()->SetBrightness(options_.brightness);
+  return result;
+}
+
+void FrameCanvasFactory::ApplyNamedPixelMappers(const char *pixel_mapper_config,
+                                                int chain, int parallel) {
+  if (pixel_mapper_config == NULL || strlen(pixel_mapper_config) == 0)
+    return;
+  char *const writeable_copy = strdup(pixel_mapper_config);
+  const char *const end = writeable_copy + strlen(writeable_copy);
+  char *s = writeable_copy;
+  while (s < end) {
+    char *const semicolon = strchrnul(s, ';');
+    *semicolon = '\0';
+    char *optional_param_start = strchr(s, ':');
+    if (optional_param_start) {
+      *optional_param_start++ = '\0';
+    }
+    if (*s == '\0' && optional_param_start && *optional_param_start != '\0') {
+      fprintf(stderr, "Stray parameter ':%s' without mapper name ?\n", optional_param_start);
+    }
+    if (*s) {
+      ApplyPixelMapper(FindPixelMapper(s, chain, parallel, optional_param_start));
+    }
+    s = semicolon + 1;
+  }
+  free(writeable_copy);
+}
+
+bool FrameCanvasFactory::ApplyPixelMapper(const PixelMapper *mapper) {
   if (mapper == NULL) return true;
   using internal::PixelDesignatorMap;
   const int old_width = shared_pixel_mapper_->width();
@@ -584,7 +682,7 @@ bool RGBMatrix::Impl::ApplyPixelMapper(const PixelMapper *mapper) {
     return false;
   }
   PixelDesignatorMap *new_mapper = new PixelDesignatorMap(
-    new_width, new_height, shared_pixel_mapper_->GetFillColorBits());
+    new_width, new_height, *shared_pixel_mapper_);
   for (int y = 0; y < new_height; ++y) {
     for (int x = 0; x < new_width; ++x) {
       int orig_x = -1, orig_y = -1;
@@ -601,6 +699,7 @@ bool RGBMatrix::Impl::ApplyPixelMapper(const PixelMapper *mapper) {
       *new_mapper->get(x, y) = *orig_designator;
     }
   }
+  new_mapper->UpdateRuns();
   delete shared_pixel_mapper_;
   shared_pixel_mapper_ = new_mapper;
   return true;
@@ -740,6 +839,9 @@ uint64_t RGBMatrix::RequestInputs(uint64_t all_interested_bits) {
 uint64_t RGBMatrix::AwaitInputChange(int timeout_ms) {
   return impl_->AwaitInputChange(timeout_ms);
 }
+int RGBMatrix::ReadInputEvents(GPIOInputEvent *events, int max_events) {
+  return impl_->ReadInputEvents(events, max_events);
+}
 
 uint64_t RGBMatrix::RequestOutputs(uint64_t all_interested_bits) {
   return impl_->RequestOutputs(all_interested_bits);
@@ -763,6 +865,16 @@ void RGBMatrix::SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue)
   impl_->active_->SetPixel(x, y, red, green, blue);
 }
 
+void RGBMatrix::SetPixels(int x, int y, int width, int height,
+                          const Color *colors) {
+  impl_->active_->SetPixels(x, y, width, height, colors);
+}
+
+void RGBMatrix::FillRect(int x, int y, int width, int height,
+                         uint8_t red, uint8_t green, uint8_t blue) {
+  impl_->active_->FillRect(x, y, width, height, red, green, blue);
+}
+
 void RGBMatrix::Clear() {
   impl_->active_->Clear();
 }
@@ -780,9 +892,13 @@ void FrameCanvas::SetPixel(int x, int y,
   frame_->SetPixel(x, y, red, green, blue);
 }
 void FrameCanvas::SetPixels(int x, int y, int width, int height,
-                         Color *colors) {
+                            const Color *colors) {
   frame_->SetPixels(x, y, width, height, colors);
 }
+void FrameCanvas::FillRect(int x, int y, int width, int height,
+                           uint8_t red, uint8_t green, uint8_t blue) {
+  frame_->FillRect(x, y, width, height, red, green, blue);
+}
 void FrameCanvas::Clear() { return frame_->Clear(); }
 void FrameCanvas::Fill(uint8_t red, uint8_t green, uint8_t blue) {
   frame_->Fill(red, green, blue);
@@ -806,4 +922,9 @@ bool FrameCanvas::Deserialize(const char *data, size_t len) {
 void FrameCanvas::CopyFrom(const FrameCanvas &other) {
   frame_->CopyFrom(other.frame_);
 }
+void FrameCanvas::Blit(const FrameCanvas &src, int src_x, int src_y,
+                       int width, int height, int dst_x, int dst_y) {
+  frame_->Blit(src.frame_, src_x, src_y, width, height, dst_x, dst_y);
+}
+void FrameCanvas::ScrollBy(int dx, int dy) { frame_->ScrollBy(dx, dy); }
 }  // end namespace rgb_matrix
@@ -186,6 +186,11 @@ static bool FlagInit(int &argc, char **&argv,
       if (ConsumeIntFlag("limit-refresh", it, end,
                          &mopts->limit_refresh_rate_hz, &err))
         continue;
+      if (ConsumeIntFlag("refresh-priority", it, end,
+                         &mopts->refresh_priority, &err))
+        continue;
+      if (ConsumeIntFlag("refresh-cpu", it, end, &mopts->refresh_cpu, &err))
+        continue;
       if (ConsumeBoolFlag("show-refresh", it, &mopts->show_refresh_rate))
         continue;
       if (ConsumeBoolFlag("inverse", it, &mopts->inverse_colors))
@@ -345,7 +350,9 @@ void PrintMatrixFlags(FILE *out, const RGBMatrix::Options &d,
           "(Default: 0)\n"
           "\t--led-%shardware-pulse   : %sse hardware pin-pulse generation.\n"
           "\t--led-panel-type=<name>   : Needed to initialize special panels. Supported: 'FM6126A', 'FM6127'\n"
-          "\t--led-%sbusy-waiting     : %sse busy waiting when limiting refresh rate.\n",
+          "\t--led-%sbusy-waiting     : %sse busy waiting when limiting refresh rate.\n"
+          "\t--led-refresh-priority=<0..99>: Realtime priority of the refresh thread. 0=no realtime (Default: %d).\n"
+          "\t--led-refresh-cpu=<cpu>   : CPU to run the refresh thread on. -1=isolated CPU if any, else last CPU (Default: %d).\n",
           d.hardware_mapping,
           d.rows, d.cols, d.chain_length, d.parallel,
           (int) muxers.size(), CreateAvailableMultiplexString(muxers).c_str(),
@@ -359,7 +366,8 @@ void PrintMatrixFlags(FILE *out, const RGBMatrix::Options &d,
           !d.disable_hardware_pulsing ? "no-" : "",
           !d.disable_hardware_pulsing ? "Don't u" : "U",
           !d.disable_busy_waiting ? "no-" : "",
-          !d.disable_busy_waiting ? "Don't u" : "U");
+          !d.disable_busy_waiting ? "Don't u" : "U",
+          d.refresh_priority, d.refresh_cpu);
 
   fprintf(out,
           "\t--led-slowdown-gpio=<%d..4>: "
@@ -462,6 +470,16 @@ bool RGBMatrix::Options::Validate(std::string *err_in) const {
     success = false;
   }
 
+  if (refresh_priority < 0 || refresh_priority > 99) {
+    err->append("Invalid range of refresh-priority (0..99 allowed).\n");
+    success = false;
+  }
+
+  if (refresh_cpu < -1 || refresh_cpu > 31) {
+    err->append("Invalid refresh-cpu (-1 for automatic or 0..31 allowed).\n");
+    success = false;
+  }
+
   if (pwm_dither_bits < 0 || pwm_dither_bits > 2) {
     err->append("Inavlid range of pwm-dither-bits (0..2 allowed).\n");
     success = false;
@@ -16,6 +16,7 @@
 #include "pixel-mapper.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -283,6 +284,92 @@ private:
   int parallel_;
 };
 
+// Binary file with a pre-computed table of matrix coordinates for each
+// visible pixel. This allows arbitrary layouts without writing a mapper,
+// and replaces a chain of mappers by a simple lookup.
+// The file starts with the MappingFileHeader, followed by
+// visible_width * visible_height MappingFileEntry, row by row.
+static constexpr uint32_t kMappingFileMagic = 0x50414D50;  // 'PMAP'
+
+struct MappingFileHeader {
+  uint32_t magic;
+  uint16_t matrix_width;
+  uint16_t matrix_height;
+  uint16_t visible_width;
+  uint16_t visible_height;
+};
+
+struct MappingFileEntry {
+  uint16_t matrix_x;
+  uint16_t matrix_y;
+};
+
+class FilePixelMapper : public PixelMapper {
+public:
+  FilePixelMapper() {}
+
+  virtual const char *GetName() const { return "File"; }
+
+  virtual bool SetParameters(int chain, int parallel, const char *param) {
+    if (param == NULL || *param == '\0') {
+      fprintf(stderr, "File: need filename, e.g. File:/path/to/layout.map\n");
+      return false;
+    }
+    FILE *f = fopen(param, "rb");
+    if (f == NULL) {
+      perror(param);
+      return false;
+    }
+    bool success = (fread(&header_, sizeof(header_), 1, f) == 1
+                    && header_.magic == kMappingFileMagic);
+    if (success) {
+      table_.resize(header_.visible_width * header_.visible_height);
+      success = (fread(table_.data(), sizeof(MappingFileEntry), table_.size(),
+                       f) == table_.size());
+    }
+    fclose(f);
+    if (!success) {
+      fprintf(stderr, "File: %s is not a pixel mapper file.\n", param);
+      return false;
+    }
+    for (size_t i = 0; i < table_.size(); ++i) {
+      if (table_[i].matrix_x >= header_.matrix_width
+          || table_[i].matrix_y >= header_.matrix_height) {
+        fprintf(stderr, "File: %s has invalid entry at %d,%d\n", param,
+                int(i % header_.visible_width), int(i / header_.visible_width));
+        return false;
+      }
+    }
+    return true;
+  }
+
+  virtual bool GetSizeMapping(int matrix_width, int matrix_height,
+                              int *visible_width, int *visible_height)
+    const {
+    if (matrix_width != header_.matrix_width
+        || matrix_height != header_.matrix_height) {
+      fprintf(stderr, "%s: Mapping is for a %dx%d matrix, but this is %dx%d\n",
+              GetName(), header_.matrix_width, header_.matrix_height,
+              matrix_width, matrix_height);
+      return false;
+    }
+    *visible_width = header_.visible_width;
+    *visible_height = header_.visible_height;
+    return true;
+  }
+
+  virtual void MapVisibleToMatrix(int matrix_width, int matrix_height,
+                                  int x, int y,
+                                  int *matrix_x, int *matrix_y) const {
+    const MappingFileEntry &entry = table_[y * header_.visible_width + x];
+    *matrix_x = entry.matrix_x;
+    *matrix_y = entry.matrix_y;
+  }
+
+private:
+  MappingFileHeader header_;
+  std::vector<MappingFileEntry> table_;
+};
 
 typedef std::map<std::string, PixelMapper*> MapperByName;
 static void RegisterPixelMapperInternal(MapperByName *registry,
@@ -302,6 +389,7 @@ static MapperByName *CreateMapperMap() {
   RegisterPixelMapperInternal(result, new UArrangementMapper());
   RegisterPixelMapperInternal(result, new VerticalMapper());
   RegisterPixelMapperInternal(result, new MirrorPixelMapper());
+  RegisterPixelMapperInternal(result, new FilePixelMapper());
   return result;
 }
 
@@ -341,4 +429,83 @@ const PixelMapper *FindPixelMapper(const char *name,
     return NULL;   // Got parameter, but couldn't deal with it.
   return mapper;
 }
+
+bool WritePixelMapperFile(const char *filename,
+                          const char *pixel_mapper_config,
+                          int chain, int parallel,
+                          int matrix_width, int matrix_height) {
+  // Start with the identity and apply one mapper after another; each
+  // entry then knows where it ends up on the original matrix.
+  int width = matrix_width;
+  int height = matrix_height;
+  std::vector<MappingFileEntry> table(width * height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      table[y * width + x].matrix_x = x;
+      table[y * width + x].matrix_y = y;
+    }
+  }
+
+  // Same syntax as --led-pixel-mapper
+  char *const writeable_copy = strdup(pixel_mapper_config);
+  const char *const end = writeable_copy + strlen(writeable_copy);
+  bool success = true;
+  for (char *s = writeable_copy; success && s < end; ) {
+    char *const semicolon = strchrnul(s, ';');
+    *semicolon = '\0';
+    char *optional_param_start = strchr(s, ':');
+    if (optional_param_start) {
+      *optional_param_start++ = '\0';
+    }
+    if (*s) {
+      const PixelMapper *mapper = FindPixelMapper(s, chain, parallel,
+                                                  optional_param_start);
+      int new_width, new_height;
+      if (mapper == NULL
+          || !mapper->GetSizeMapping(width, height, &new_width, &new_height)) {
+        success = false;
+        break;
+      }
+      std::vector<MappingFileEntry> new_table(new_width * new_height);
+      for (int y = 0; y < new_height && success; ++y) {
+        for (int x = 0; x < new_width; ++x) {
+          int orig_x = -1, orig_y = -1;
+          mapper->MapVisibleToMatrix(width, height, x, y, &orig_x, &orig_y);
+          if (orig_x < 0 || orig_y < 0 ||
+              orig_x >= width || orig_y >= height) {
+            fprintf(stderr, "Error in PixelMapper: (%d, %d) -> (%d, %d) "
+                    "[range: %dx%d]\n", x, y, orig_x, orig_y, width, height);
+            success = false;
+            break;
+          }
+          new_table[y * new_width + x] = table[orig_y * width + orig_x];
+        }
+      }
+      table.swap(new_table);
+      width = new_width;
+      height = new_height;
+    }
+    s = semicolon + 1;
+  }
+  free(writeable_copy);
+  if (!success) return false;
+
+  FILE *f = fopen(filename, "wb");
+  if (f == NULL) {
+    perror(filename);
+    return false;
+  }
+  MappingFileHeader header;
+  header.magic = kMappingFileMagic;
+  header.matrix_width = matrix_width;
+  header.matrix_height = matrix_height;
+  header.visible_width = width;
+  header.visible_height = height;
+  success = (fwrite(&header, sizeof(header), 1, f) == 1
+             && fwrite(table.data(), sizeof(MappingFileEntry), table.size(),
+                       f) == table.size());
+  if (fclose(f) != 0) success = false;
+  if (!success) perror(filename);
+  return success;
+}
 }  // namespace rgb_matrix
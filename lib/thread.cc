@@ -16,11 +16,15 @@
 #include "thread.h"
 
 #include <assert.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 namespace rgb_matrix {
 void *Thread::PthreadCallRun(void *tobject) {
@@ -97,4 +101,47 @@ bool Mutex::WaitOn(pthread_cond_t *cond, long timeout_ms) {
     return pthread_cond_timedwait(cond, &mutex_, &t) == 0;
   }
 }
+
+uint32_t GetIsolatedCPUs() {
+  char buf[256];
+  const int fd = open("/sys/devices/system/cpu/isolated", O_RDONLY);
+  if (fd < 0) return 0;
+  const ssize_t r = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (r <= 0) return 0;
+  buf[r] = '\0';
+
+  // A list of CPUs and ranges, e.g. "3" or "1,3" or "2-3".
+  uint32_t result = 0;
+  const char *pos = buf;
+  while (isdigit(*pos)) {
+    char *end;
+    const int first = strtol(pos, &end, 10);
+    int last = first;
+    if (*end == '-') last = strtol(end + 1, &end, 10);
+    for (int cpu = first; cpu <= last && cpu < 32; ++cpu) {
+      result |= (1 << cpu);
+    }
+    pos = (*end == ',') ? end + 1 : end;
+  }
+  return result;
+}
+
+void KeepThreadsOffCPU(int cpu) {
+  DIR *const dir = opendir("/proc/self/task");
+  if (dir == NULL) return;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    const pid_t tid = atoi(entry->d_name);
+    if (tid <= 0) continue;
+    cpu_set_t cpu_mask;
+    if (sched_getaffinity(tid, sizeof(cpu_mask), &cpu_mask) != 0)
+      continue;
+    if (!CPU_ISSET(cpu, &cpu_mask) || CPU_COUNT(&cpu_mask) == 1)
+      continue;
+    CPU_CLR(cpu, &cpu_mask);
+    sched_setaffinity(tid, sizeof(cpu_mask), &cpu_mask);
+  }
+  closedir(dir);
+}
 }  // namespace rgb_matrix
@@ -0,0 +1,253 @@
+#include "beat-tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Seconds of spectral flux the tempo and phase are estimated from.
+#define HISTORY_SECONDS 4.0
+// Onsets are compared with the average flux of this many seconds.
+#define ONSET_AVERAGE_SECONDS 1.0
+// Minimum autocorrelation, relative to the signal energy, of a tempo.
+#define MIN_TEMPO_CORRELATION 0.25
+// Preferred tempo; autocorrelation peaks at other octaves are weighed down.
+#define PREFERRED_BPM 120.0
+// A signal with a period correlates as well at twice the period. If the
+// correlation at half the chosen period is at least this fraction of it,
+// that is the tempo.
+#define OCTAVE_TIE 0.9
+// Fraction of the phase and tempo error corrected with each block.
+#define PHASE_GAIN 0.1
+#define PERIOD_GAIN 0.05
+// Tempo changes larger than this are a new tempo, not a drift.
+#define MAX_PERIOD_DRIFT 0.1
+// Seconds a tempo needs to be steady before the clock locks on it.
+#define LOCK_SECONDS 1.0
+// Seconds without a steady tempo after which the clock is unlocked.
+#define UNSTEADY_SECONDS 2.0
+
+BeatTracker::BeatTracker(double blocksPerSecond, double minBpm, double maxBpm)
+    : blockMicros(1e6 / blocksPerSecond),
+      minPeriodBlocks(60.0 / maxBpm * blocksPerSecond),
+      maxPeriodBlocks(60.0 / minBpm * blocksPerSecond),
+      sensitivity(1.5),
+      fluxHistory(std::max(1, (int)ceil(HISTORY_SECONDS * blocksPerSecond)), 0.0),
+      fluxCount(0), lastFlux(0), locked(false), beatTime(0), period(5e5),
+      steadyBlocks(0), unsteadyBlocks(0) {}
+
+// Average increase of the log magnitudes. The log makes quiet and loud
+// parts of the music count alike.
+double BeatTracker::SpectralFlux(const double *magnitudes, int bins) {
+    if ((int)previousLog.size() != bins) previousLog.assign(bins, 0.0);
+    double flux = 0.0;
+    for (int i = 0; i < bins; ++i) {
+        const double logMagnitude = log1p(magnitudes[i]);
+        const double diff = logMagnitude - previousLog[i];
+        if (diff > 0) flux += diff;
+        previousLog[i] = logMagnitude;
+    }
+    return bins > 0 ? flux / bins : 0.0;
+}
+
+double BeatTracker::FluxAt(int age) const {
+    const int size = fluxHistory.size();
+    return fluxHistory[(fluxCount - 1 - age + size) % size];
+}
+
+// The period of the onsets is where their autocorrelation peaks.
+bool BeatTracker::EstimatePeriod(double *periodBlocks) {
+    const int n = std::min(fluxCount, (int)fluxHistory.size());
+    const int maxLag = (int)ceil(maxPeriodBlocks) + 1;
+    if (n < 2 * maxLag) return false;
+
+    double mean = 0.0;
+    for (int i = 0; i < n; ++i) mean += FluxAt(i);
+    mean /= n;
+    // Smoothed a little, so that beats between two blocks still correlate.
+    std::vector<double> d(n);
+    double energy = 0.0;
+    for (int i = 0; i < n; ++i) {
+        const double before = FluxAt(std::max(i - 1, 0));
+        const double after = FluxAt(std::min(i + 1, n - 1));
+        d[i] = 0.25 * before + 0.5 * FluxAt(i) + 0.25 * after - mean;
+        energy += d[i] * d[i];
+    }
+    energy /= n;
+    if (energy <= 0) return false;
+
+    std::vector<double> correlation(maxLag + 1, 0.0);
+    const int minLag = std::max(1, (int)floor(minPeriodBlocks) - 1);
+    for (int lag = minLag; lag <= maxLag; ++lag) {
+        double sum = 0.0;
+        for (int i = 0; i + lag < n; ++i) sum += d[i] * d[i + lag];
+        correlation[lag] = sum / (n - lag) / energy;
+    }
+
+    // Peaks of the autocorrelation within the tempo range. Blocks are
+    // coarse; store where the top of the peak is between them, 0 for none.
+    // That is only precise to about half a block, so allow that much at the
+    // ends of the range.
+    std::vector<double> peak(maxLag + 1, 0.0);
+    for (int lag = minLag + 1; lag < maxLag; ++lag) {
+        const double left = correlation[lag - 1];
+        const double center = correlation[lag];
+        const double right = correlation[lag + 1];
+        if (center < MIN_TEMPO_CORRELATION || center < left || center < right)
+            continue;
+        const double curvature = left - 2 * center + right;
+        const double offset = curvature < 0
+            ? 0.5 * (left - right) / curvature : 0.0;
+        const double top = lag + std::max(-0.5, std::min(0.5, offset));
+        if (top >= minPeriodBlocks - 0.5 && top <= maxPeriodBlocks + 0.5)
+            peak[lag] = std::max(minPeriodBlocks, std::min(maxPeriodBlocks, top));
+    }
+
+    const double preferredLag = 60.0 / PREFERRED_BPM * 1e6 / blockMicros;
+    int best = -1;
+    double bestScore = 0.0;
+    for (int lag = minLag + 1; lag < maxLag; ++lag) {
+        if (peak[lag] == 0) continue;
+        const double octaves = log2(peak[lag] / preferredLag);
+        const double score = correlation[lag] * exp(-0.5 * octaves * octaves);
+        if (score > bestScore) {
+            bestScore = score;
+            best = lag;
+        }
+    }
+    if (best < 0) return false;
+
+    // Above about 170 bpm, the preference for 120 bpm would pick half the
+    // tempo otherwise. A peak between two blocks is split between them, so
+    // compare the sum of the two.
+    auto strength = [&correlation](int lag) {
+        return correlation[lag]
+            + std::max(correlation[lag - 1], correlation[lag + 1]);
+    };
+    for (bool faster = true; faster; ) {
+        faster = false;
+        const int from = std::max(minLag + 1, best / 2 - 1);
+        const int to = std::min(maxLag - 1, (best + 1) / 2 + 1);
+        for (int lag = from; lag <= to; ++lag) {
+            if (peak[lag] > 0 && strength(lag) >= OCTAVE_TIE * strength(best)) {
+                best = lag;
+                faster = true;
+                break;
+            }
+        }
+    }
+    *periodBlocks = peak[best];
+    return true;
+}
+
+// Returns how many blocks ago the last beat was: the phase at which a comb
+// of beats lines up with the most flux. Recent beats weigh more. The
+// score of that phase is stored in "score".
+double BeatTracker::EstimateBeatAge(double periodBlocks, double *score) const {
+    const int n = std::min(fluxCount, (int)fluxHistory.size());
+    const int phases = (int)ceil(periodBlocks);
+    std::vector<double> scores(phases, 0.0);
+    for (int phase = 0; phase < phases; ++phase) {
+        double weight = 1.0;
+        for (double age = phase; age < n - 1; age += periodBlocks) {
+            const int i = (int)age;
+            const double fraction = age - i;
+            scores[phase] += weight * ((1 - fraction) * FluxAt(i)
+                                       + fraction * FluxAt(i + 1));
+            weight *= 0.8;
+        }
+    }
+
+    const int best = std::max_element(scores.begin(), scores.end())
+        - scores.begin();
+    *score = scores[best];
+    const double left = scores[(best + phases - 1) % phases];
+    const double right = scores[(best + 1) % phases];
+    const double curvature = left - 2 * scores[best] + right;
+    const double offset = curvature < 0
+        ? 0.5 * (left - right) / curvature : 0.0;
+    return best + std::max(-0.5, std::min(0.5, offset));
+}
+
+bool BeatTracker::Process(const double *magnitudes, int bins,
+                          uint64_t timestamp) {
+    const double flux = SpectralFlux(magnitudes, bins);
+
+    // Onset: the flux rises well above its recent average.
+    const int averageBlocks = std::min(
+        fluxCount, std::max(1, (int)(ONSET_AVERAGE_SECONDS * 1e6 / blockMicros)));
+    double average = 0.0;
+    for (int i = 0; i < averageBlocks; ++i) average += FluxAt(i);
+    if (averageBlocks > 0) average /= averageBlocks;
+    const double threshold = average * sensitivity;
+    const bool onset = averageBlocks > 0 && flux > threshold
+        && lastFlux <= threshold;
+    lastFlux = flux;
+
+    fluxHistory[fluxCount % fluxHistory.size()] = flux;
+    ++fluxCount;
+
+    double periodBlocks;
+    const int unsteadyLimit = (int)(UNSTEADY_SECONDS * 1e6 / blockMicros);
+    if (!EstimatePeriod(&periodBlocks)) {
+        steadyBlocks = 0;
+        if (++unsteadyBlocks > unsteadyLimit) locked = false;
+        return onset;
+    }
+
+    // The autocorrelation only is precise to about a block. Refine the
+    // period to where the comb of beats matches the onsets best.
+    double beatAge = 0.0;
+    double bestScore = -1.0;
+    const double coarsePeriod = periodBlocks;
+    for (double delta = -0.6; delta <= 0.6; delta += 0.05) {
+        double score;
+        const double age = EstimateBeatAge(coarsePeriod + delta, &score);
+        if (score > bestScore) {
+            bestScore = score;
+            beatAge = age;
+            periodBlocks = coarsePeriod + delta;
+        }
+    }
+
+    const double observedPeriod = periodBlocks * blockMicros;
+    const double observedBeat = timestamp - beatAge * blockMicros;
+    if (!locked) {
+        // Noise has peaks in the autocorrelation as well, but they don't
+        // stay at the same tempo.
+        if (steadyBlocks > 0
+            && fabs(observedPeriod - period) <= MAX_PERIOD_DRIFT * period) {
+            ++steadyBlocks;
+        } else {
+            steadyBlocks = 1;
+        }
+        period = observedPeriod;
+        beatTime = observedBeat;
+        if (steadyBlocks > (int)(LOCK_SECONDS * 1e6 / blockMicros)) {
+            locked = true;
+            unsteadyBlocks = 0;
+        }
+        return onset;
+    }
+
+    if (fabs(observedPeriod - period) > MAX_PERIOD_DRIFT * period) {
+        // Different tempo. If it stays that way, start over; the new
+        // tempo is locked on once it is steady.
+        if (++unsteadyBlocks > unsteadyLimit) {
+            locked = false;
+            steadyBlocks = 0;
+        }
+        return onset;
+    }
+    unsteadyBlocks = 0;
+    period += PERIOD_GAIN * (observedPeriod - period);
+
+    // Move the clock to the beat closest to the observation, then nudge it
+    // towards it.
+    beatTime += round((observedBeat - beatTime) / period) * period;
+    beatTime += PHASE_GAIN * (observedBeat - beatTime);
+    return onset;
+}
+
+uint64_t BeatTracker::NextBeat(uint64_t now) const {
+    const double beats = floor((now - beatTime) / period) + 1;
+    return (uint64_t)(beatTime + beats * period);
+}
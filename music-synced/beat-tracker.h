@@ -0,0 +1,70 @@
+#ifndef BEAT_TRACKER_H
+#define BEAT_TRACKER_H
+
+#include <stdint.h>
+#include <vector>
+
+// Follows the beat of music, so that flashes can be scheduled on the next
+// beat instead of after it was heard.
+//
+// Feed it the magnitude spectrum of each captured audio block. It
+//  - detects onsets with the spectral flux: the sum of the increases of the
+//    log magnitudes from the previous block,
+//  - estimates the tempo from the autocorrelation of the last seconds of
+//    spectral flux,
+//  - and locks a beat clock onto the phase that lines up with the onsets
+//    best, correcting it a little with every block.
+// Once locked, NextBeat() predicts when the next beat happens.
+//
+// Half and double of a tempo look alike; if both are in range and about
+// as strong, the tracker goes for the faster one.
+//
+// Timestamps are in microseconds of CLOCK_MONOTONIC.
+class BeatTracker {
+public:
+    // "blocksPerSecond": rate at which blocks are fed with Process().
+    // Tempos outside of minBpm..maxBpm are not considered.
+    BeatTracker(double blocksPerSecond, double minBpm = 60, double maxBpm = 180);
+
+    // Process the magnitudes of "bins" frequency bins of the next block,
+    // which was captured around "timestamp". Returns true if the block
+    // starts an onset, a sudden increase of energy.
+    bool Process(const double *magnitudes, int bins, uint64_t timestamp);
+
+    // Onsets need to be this many times the recent average (default: 1.5).
+    void SetSensitivity(double factor) { sensitivity = factor; }
+
+    // Returns if there is a steady tempo and the beat clock is locked on it.
+    bool Locked() const { return locked; }
+
+    // Current tempo estimate, beats per minute. Only meaningful if Locked().
+    double Bpm() const { return 60e6 / period; }
+
+    // Time of the first beat after "now". Only meaningful if Locked().
+    uint64_t NextBeat(uint64_t now) const;
+
+private:
+    double SpectralFlux(const double *magnitudes, int bins);
+    double FluxAt(int age) const;  // age 0 is the latest block.
+    bool EstimatePeriod(double *periodBlocks);
+    double EstimateBeatAge(double periodBlocks, double *score) const;
+
+    const double blockMicros;
+    const double minPeriodBlocks;
+    const double maxPeriodBlocks;
+    double sensitivity;
+
+    std::vector<double> previousLog;   // Log magnitudes of previous block.
+    std::vector<double> fluxHistory;   // Ring buffer of the spectral flux.
+    int fluxCount;                     // Blocks seen so far.
+    double lastFlux;
+
+    // The beat clock: a beat at "beatTime", then every "period" micros.
+    bool locked;
+    double beatTime;
+    double period;
+    int steadyBlocks;                  // Blocks with the same tempo.
+    int unsteadyBlocks;                // Blocks without a clear tempo.
+};
+
+#endif  // BEAT_TRACKER_H
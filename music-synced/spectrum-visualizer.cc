@@ -25,6 +25,7 @@
 */
 
 using rgb_matrix::Canvas;
+using rgb_matrix::Color;
 using rgb_matrix::RGBMatrix;
 
 const int NUM_BINS = BUFFER_SIZE / 2;  // only half is useful in real FFT
@@ -271,27 +272,23 @@ int main(int argc, char *argv[]){
             
             int visualHeight = static_cast<int>(smoothHeights[i]);
 
-            // Drawing to the panel
-            int y;
-            for (y = 0; y < visualHeight; ++y) {
-                if (y < heightGreen_) {
-                    for (int x = i * barWidth_; x < (i + 1) * barWidth_; ++x) 
-                        matrix->SetPixel(x, height_ - 1 - y, 0, 200, 0);
-                } else if (y < heightYellow_) {
-                    for (int x = i * barWidth_; x < (i + 1) * barWidth_; ++x) 
-                        matrix->SetPixel(x, height_ - 1 - y, 150, 150, 0);
-                } else if (y < heightOrange_) {
-                    for (int x = i * barWidth_; x < (i + 1) * barWidth_; ++x) 
-                        matrix->SetPixel(x, height_ - 1 - y, 250, 100, 0);
-                } else {
-                    for (int x = i * barWidth_; x < (i + 1) * barWidth_; ++x) 
-                        matrix->SetPixel(x, height_ - 1 - y, 200, 0, 0);
-                }
-            }
-            for (; y < height_; ++y) {
-                for (int x = i * barWidth_; x < (i + 1) * barWidth_; ++x) 
-                    matrix->SetPixel(x, height_ - 1 - y, 0, 0, 0);
+            // Drawing to the panel: one rectangle per color zone of the bar,
+            // the rest of the column is cleared.
+            const int zoneTop[] = { heightGreen_, heightYellow_, heightOrange_,
+                                    visualHeight };
+            const Color zoneColor[] = { Color(0, 200, 0), Color(150, 150, 0),
+                                        Color(250, 100, 0), Color(200, 0, 0) };
+            const int barX = i * barWidth_;
+            int y = 0;
+            for (int z = 0; z < 4 && y < visualHeight; ++z) {
+                const int top = std::min(zoneTop[z], visualHeight);
+                if (top <= y) continue;
+                rgb_matrix::FillRect(matrix, barX, height_ - top,
+                                     barWidth_, top - y, zoneColor[z]);
+                y = top;
             }
+            rgb_matrix::FillRect(matrix, barX, 0, barWidth_, height_ - y,
+                                 Color(0, 0, 0));
         }
 
         frameCount++;
@@ -2,13 +2,14 @@
 #include <alsa/asoundlib.h>
 #include <cmath>
 #include <vector>
-#include <deque>
 #include <fftw3.h>
 #include <chrono>
 #include <iomanip>
 #include "led-matrix.h"
+#include "beat-tracker.h"
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
 
 #define PCM_DEVICE "hw:0,0" // USB Dongle audio input
 #define SAMPLE_RATE 44100   // 44.1 kHz sample rate
@@ -20,6 +21,7 @@
     44100 / 512  = 86.13Hz
 
 */
+#define TRACKED_BINS 128    // Bins 1-128 cover approx 40Hz - 5.5kHz
 
 using rgb_matrix::Canvas;
 using rgb_matrix::RGBMatrix;
@@ -28,6 +30,12 @@ using rgb_matrix::RGBMatrix;
 bool keep_running = true;
 void intHandler(int dummy) { keep_running = false; }
 
+static uint64_t GetMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 int configure_pcm_device(snd_pcm_t *&pcm_handle, snd_pcm_format_t format, unsigned int rate, int channels) {
     if (snd_pcm_open(&pcm_handle, PCM_DEVICE, SND_PCM_STREAM_CAPTURE, 0) < 0) return -1;
     snd_pcm_hw_params_t *params;
@@ -46,7 +54,7 @@ int main(int argc, char *argv[]) {
 
     // 1. Settings
     int brightness = 80;
-    double sensitivity = 1.3; // Multiplier: Trigger if current bass is 1.3x higher than average
+    double sensitivity = 1.5; // Multiplier: Onset if the spectral flux is 1.5x higher than average
     if (argc > 1) brightness = std::stoi(argv[1]);
     if (argc > 2) sensitivity = std::stod(argv[2]);
 
@@ -70,8 +78,12 @@ int main(int argc, char *argv[]) {
 
     // 5. Detection Variables
     std::vector<short> audio_buffer(BUFFER_SIZE);
-    std::deque<double> history;
-    const int history_limit = 25; // ~1 second of audio history
+    std::vector<double> magnitudes(TRACKED_BINS);
+    const uint64_t block_us = 1000000ull * BUFFER_SIZE / SAMPLE_RATE;
+    BeatTracker tracker((double)SAMPLE_RATE / BUFFER_SIZE);
+    tracker.SetSensitivity(sensitivity);
+    bool was_locked = false;
+    uint64_t last_flash = 0;
     float current_brightness = 0.0;
     float decay_rate = 0.85;
     
@@ -82,6 +94,7 @@ int main(int argc, char *argv[]) {
             snd_pcm_prepare(pcm_handle);
             continue;
         }
+        const uint64_t now = GetMicros();
 
         // Apply Hann Window and load FFT
         for (int i = 0; i < BUFFER_SIZE; i++) {
@@ -92,23 +105,41 @@ int main(int argc, char *argv[]) {
 
         fftw_execute(plan);
 
-        // Analyze Bass Range (Bins 1-4 cover approx 40Hz - 170Hz)
-        double current_bass_energy = 0;
-        for (int i = 1; i <= 4; i++) {
-            double mag = sqrt(out[i][0] * out[i][0] + out[i][1] * out[i][1]);
-            current_bass_energy += mag;
+        for (int i = 0; i < TRACKED_BINS; i++) {
+            magnitudes[i] = sqrt(out[i + 1][0] * out[i + 1][0] + out[i + 1][1] * out[i + 1][1]);
         }
-        current_bass_energy /= 4.0;
 
-        // Calculate Moving Average
-        double avg_bass_energy = 0;
-        if (!history.empty()) {
-            for (double val : history) avg_bass_energy += val;
-            avg_bass_energy /= history.size();
+        // The spectrum describes the middle of the block we just read.
+        const bool onset = tracker.Process(magnitudes.data(), TRACKED_BINS, now - block_us / 2);
+        if (tracker.Locked() != was_locked) {
+            was_locked = tracker.Locked();
+            if (was_locked)
+                std::cout << "Tempo: " << std::fixed << std::setprecision(1) << tracker.Bpm() << " bpm" << std::endl;
+            else
+                std::cout << "Lost the beat" << std::endl;
         }
 
         // 3. Trigger Logic
-        if (current_bass_energy > (avg_bass_energy * sensitivity) && current_bass_energy > 1000) {
+        bool flash = false;
+        if (tracker.Locked()) {
+            // Flash right on the predicted beat, if it comes before the next
+            // block is read, instead of a block after hearing it.
+            const uint64_t beat = tracker.NextBeat(now - block_us);
+            const uint64_t min_distance = 30e6 / tracker.Bpm();  // Half a beat
+            if (beat < now + block_us && beat > last_flash + min_distance) {
+                if (beat > now) usleep(beat - now);
+                last_flash = beat;
+                flash = true;
+            }
+        } else {
+            // No steady tempo: follow the onsets, if there is some bass
+            // (Bins 1-4 cover approx 40Hz - 170Hz)
+            double bass_energy = 0;
+            for (int i = 0; i < 4; i++) bass_energy += magnitudes[i];
+            flash = onset && bass_energy / 4.0 > 1000;
+        }
+
+        if (flash) {
             current_brightness = 255.0; // Instant "On" for the beat
         } else {
             current_brightness *= decay_rate; // Smooth "Fade out"
@@ -118,10 +149,6 @@ int main(int argc, char *argv[]) {
         // 4. Apply to Matrix
         int b = static_cast<int>(current_brightness);
         matrix->Fill(b, b, b);
-
-        // Update History
-        history.push_back(current_bass_energy);
-        if (history.size() > history_limit) history.pop_front();
     }
 
     // Cleanup
@@ -2,30 +2,49 @@
 #include <cmath>
 #include <vector>
 #include <iomanip>
+#include <algorithm>
 
 #include "led-matrix.h"
 #include <unistd.h>
 #include <math.h>
 #include <stdio.h>
 #include <signal.h>
+#include <time.h>
 
 using rgb_matrix::RGBMatrix;
 using rgb_matrix::Canvas;
+using rgb_matrix::GPIOInputEvent;
+
+// Taps further apart than this start a new tempo.
+#define TAP_TIMEOUT_US 2000000
+// Number of tap intervals averaged for the tempo.
+#define TAP_INTERVALS 4
+// A button bounces for a few ms when pressed or released. Presses closer
+// than this to the previous tap, or to the last release, are ignored.
+#define TAP_DEBOUNCE_US 80000
+#define RELEASE_DEBOUNCE_US 20000
+// Shortest tapped period (300 bpm).
+#define MIN_TAP_PERIOD_US 200000
 
 volatile bool interrupt_received = false;
 static void InterruptHandler(int signo) {
   interrupt_received = true;
 }
 
-int processArguments(int argc, char *argv[], int *onTimems, int *offTimems, int *brightness) {
+int processArguments(int argc, char *argv[], int *onTimems, int *offTimems, int *brightness, int *tapGpio) {
     if (argc < 4) {
-        std::cerr << "Usage: " << argv[0] << " <onTimems> <offTimems> <brightness>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <onTimems> <offTimems> <brightness> [<tap-gpio>]" << std::endl;
+        std::cerr << "With a button from <tap-gpio> to ground, the strobe follows the tempo it is tapped in." << std::endl;
         return -1;
     }
  
     *onTimems = static_cast<int>(std::stoi(argv[1]));
     *offTimems = static_cast<int>(std::stoi(argv[2]));
     *brightness = static_cast<int>(std::stoi(argv[3]));
+    if (argc > 4) {
+        *tapGpio = static_cast<int>(std::stoi(argv[4]));
+        std::cout << "Tap tempo on GPIO: " << *tapGpio << std::endl;
+    }
 
     std::cout << "On time in ms: " << static_cast<int>(*onTimems) << std::endl;
     std::cout << "Off time in ms: " << static_cast<int>(*offTimems) << std::endl;
@@ -34,26 +53,113 @@ int processArguments(int argc, char *argv[], int *onTimems, int *offTimems, int
     return 0;
 }
 
-static void MatrixStrobe(Canvas *canvas, int onTimems, int offTimems, int brightness) {
+static uint64_t GetMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Follows the tempo of button presses. Each press also restarts the phase,
+// so that the flash is in sync with the tap.
+class TapTempo {
+public:
+    TapTempo(uint64_t tapMask) : tapMask(tapMask), pressed(false),
+                                 lastTap(0), lastRelease(0), intervalCount(0) {}
+
+    // Process input events; returns true if a tap was seen. Then "period"
+    // and "phaseStart" are updated.
+    bool Update(RGBMatrix *matrix, uint64_t *period, uint64_t *phaseStart) {
+        GPIOInputEvent events[16];
+        bool tapped = false;
+        int count;
+        while ((count = matrix->ReadInputEvents(events, 16)) > 0) {
+            for (int i = 0; i < count; ++i) {
+                // Button to ground: pressed when low.
+                const bool isPressed = (events[i].bits & tapMask) == 0;
+                const uint64_t when = events[i].timestamp_usec;
+                if (isPressed && !pressed
+                    && when - lastTap >= TAP_DEBOUNCE_US
+                    && when - lastRelease >= RELEASE_DEBOUNCE_US) {
+                    Tap(when, period);
+                    *phaseStart = when;
+                    tapped = true;
+                }
+                if (!isPressed && pressed) lastRelease = when;
+                pressed = isPressed;
+            }
+        }
+        return tapped;
+    }
+
+private:
+    void Tap(uint64_t when, uint64_t *period) {
+        if (lastTap != 0 && when - lastTap < TAP_TIMEOUT_US) {
+            intervals[intervalCount % TAP_INTERVALS] = when - lastTap;
+            ++intervalCount;
+            const int n = std::min(intervalCount, TAP_INTERVALS);
+            uint64_t sum = 0;
+            for (int i = 0; i < n; ++i) sum += intervals[i];
+            *period = std::max(sum / n, (uint64_t)MIN_TAP_PERIOD_US);
+        } else {
+            intervalCount = 0;
+        }
+        lastTap = when;
+    }
+
+    const uint64_t tapMask;
+    bool pressed;
+    uint64_t lastTap;
+    uint64_t lastRelease;
+    uint64_t intervals[TAP_INTERVALS];
+    int intervalCount;
+};
+
+static void MatrixStrobe(RGBMatrix *matrix, int onTimems, int offTimems, int brightness, int tapGpio) {
+    uint64_t period = std::max(onTimems + offTimems, 1) * 1000;
+    const float onRatio = (float)onTimems / std::max(onTimems + offTimems, 1);
+    uint64_t phaseStart = GetMicros();
+
+    TapTempo tapTempo(tapGpio >= 0 ? (1ull << tapGpio) : 0);
+    if (tapGpio >= 0 && matrix->RequestInputs(1ull << tapGpio) == 0) {
+        std::cerr << "GPIO " << tapGpio << " not available for tap tempo" << std::endl;
+        tapGpio = -1;
+    }
 
-    while(true) {
-        if (interrupt_received){
-            return;
+    bool isOn = false;
+    matrix->Fill(0, 0, 0);
+    while (!interrupt_received) {
+        if (tapGpio >= 0 && tapTempo.Update(matrix, &period, &phaseStart)) {
+            std::cout << "Tempo: " << std::fixed << std::setprecision(1)
+                      << 60e6 / period << " bpm" << std::endl;
         }
-        canvas->Fill(255, 255, 255);
-        usleep(onTimems * 1000); 
-        canvas->Fill(0, 0, 0);
-        usleep(offTimems * 1000);
+
+        const uint64_t now = GetMicros();
+        const uint64_t position = (now - phaseStart) % period;
+        const uint64_t onTime = period * onRatio;
+        const bool shouldBeOn = position < onTime;
+        if (shouldBeOn != isOn) {
+            if (shouldBeOn)
+                matrix->Fill(255, 255, 255);
+            else
+                matrix->Fill(0, 0, 0);
+            isOn = shouldBeOn;
+        }
+
+        // Sleep until the next change, but check for taps regularly.
+        uint64_t wait = shouldBeOn ? onTime - position : period - position;
+        if (tapGpio >= 0) wait = std::min(wait, (uint64_t)5000);
+        usleep(wait);
     }
-  }
+}
 
 int main(int argc, char *argv[]){
     //************ INPUT VARS ************/
     int onTimems = 200;
     int offTimems = 200;
     int brightness = 80;
+    int tapGpio = -1;
 
-    if(processArguments(argc, argv, &onTimems, &offTimems, &brightness) < 0){
+    if(processArguments(argc, argv, &onTimems, &offTimems, &brightness, &tapGpio) < 0){
         return -1;
     }
 
@@ -76,7 +182,7 @@ int main(int argc, char *argv[]){
     signal(SIGTERM, InterruptHandler);
     signal(SIGINT, InterruptHandler);
 
-    MatrixStrobe(matrix, onTimems, offTimems, brightness);
+    MatrixStrobe(matrix, onTimems, offTimems, brightness, tapGpio);
 
     matrix->Clear();
     delete matrix;
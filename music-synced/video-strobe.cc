@@ -22,6 +22,7 @@
 #include "led-matrix.h"
 #include "pixel-mapper.h"
 #include "content-streamer.h"
+#include "layer-compositor.h"
 
 #include <fcntl.h>
 #include <math.h>
@@ -60,7 +61,14 @@
 #define SAMPLE_RATE 44100   // 44.1 kHz sample rate
 #define BUFFER_SIZE 1024
 
+// Bass magnitude range (dB) mapped to the opacity of the flash overlay.
+#define FLASH_MIN_DB 90.0
+#define FLASH_MAX_DB 130.0
+
 using rgb_matrix::Canvas;
+using rgb_matrix::Color;
+using rgb_matrix::Layer;
+using rgb_matrix::LayerCompositor;
 using rgb_matrix::FrameCanvas;
 using rgb_matrix::RGBMatrix;
 using rgb_matrix::StreamReader;
@@ -81,6 +89,7 @@ struct ImageParams {
 struct FileInfo {
   ImageParams params;      // Each file might have specific timing settings
   bool is_multi_frame = false;
+  bool is_portable = false;  // RGB stream that can be shown with the overlay.
   rgb_matrix::StreamIO *content_stream = nullptr;
 };
 
@@ -175,25 +184,37 @@ std::vector<double> computeFFT(std::vector<short>& buffer) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+// Store image in stream. Portable streams keep the RGB pixels, so that
+// they can be composed with the overlay when shown.
 static void StoreInStream(const Magick::Image &img, int delay_time_us,
-                          bool do_center,
+                          bool do_center, bool portable,
                           rgb_matrix::FrameCanvas *scratch,
                           rgb_matrix::StreamWriter *output) {
-  scratch->Clear();
-  const int x_offset = do_center ? (scratch->width() - img.columns()) / 2 : 0;
-  const int y_offset = do_center ? (scratch->height() - img.rows()) / 2 : 0;
+  const int width = scratch->width();
+  const int height = scratch->height();
+  const int x_offset = do_center ? (width - img.columns()) / 2 : 0;
+  const int y_offset = do_center ? (height - img.rows()) / 2 : 0;
+  std::vector<Color> pixels(width * height);
   for (size_t y = 0; y < img.rows(); ++y) {
+    const int py = y + y_offset;
+    if (py < 0 || py >= height) continue;
     for (size_t x = 0; x < img.columns(); ++x) {
+      const int px = x + x_offset;
+      if (px < 0 || px >= width) continue;
       const Magick::Color &c = img.pixelColor(x, y);
       if (c.alphaQuantum() < 255) {
-        scratch->SetPixel(x + x_offset, y + y_offset,
-                          ScaleQuantumToChar(c.redQuantum()),
-                          ScaleQuantumToChar(c.greenQuantum()),
-                          ScaleQuantumToChar(c.blueQuantum()));
+        pixels[py * width + px] = Color(ScaleQuantumToChar(c.redQuantum()),
+                                        ScaleQuantumToChar(c.greenQuantum()),
+                                        ScaleQuantumToChar(c.blueQuantum()));
       }
     }
   }
-  output->Stream(*scratch, delay_time_us);
+  if (portable) {
+    output->StreamRGB(pixels.data(), width, height, delay_time_us);
+  } else {
+    scratch->SetPixels(0, 0, width, height, pixels.data());
+    output->Stream(*scratch, delay_time_us);
+  }
 }
 
 static void CopyStream(rgb_matrix::StreamReader *r,
@@ -263,7 +284,20 @@ static bool LoadImageAndScale(const char *filename,
   return true;
 }
 
-void DisplayAnimation(const FileInfo *file, RGBMatrix *matrix, FrameCanvas *offscreen_canvas, snd_pcm_t *&pcm_handle) {
+// Opacity of the flash overlay for the given bass magnitude.
+static uint8_t FlashOpacity(double magnitude_db) {
+  const double fraction = (magnitude_db - FLASH_MIN_DB)
+    / (FLASH_MAX_DB - FLASH_MIN_DB);
+  return (uint8_t) roundf(255 * clamp(fraction, 0.0, 1.0));
+}
+
+// Portable streams are read into the video layer, with the flash layer
+// composed on top. Other streams are shown as they are.
+void DisplayAnimation(const FileInfo *file, RGBMatrix *matrix,
+                      FrameCanvas *offscreen_canvas,
+                      LayerCompositor *compositor,
+                      Layer *video_layer, Layer *flash_layer,
+                      snd_pcm_t *&pcm_handle) {
 
   const tmillis_t duration_ms = (file->is_multi_frame
                                  ? file->params.anim_duration_ms
@@ -286,12 +320,18 @@ void DisplayAnimation(const FileInfo *file, RGBMatrix *matrix, FrameCanvas *offs
     std::vector<double> magnitudesDB;
 
     while (!interrupt_received && GetTimeInMillis() <= end_time_ms
-           && reader.GetNext(offscreen_canvas, &delay_us)) {
+           && (file->is_portable
+               ? reader.GetNextRGB(video_layer, &delay_us)
+               : reader.GetNext(offscreen_canvas, &delay_us))) {
       const tmillis_t anim_delay_ms = override_anim_delay >= 0 ? override_anim_delay : delay_us / 1000;
       const tmillis_t start_wait_ms = GetTimeInMillis();
       snd_pcm_readi(pcm_handle, buffer.data(), buffer_size);
       magnitudesDB = computeFFT(buffer);
       fprintf(stderr, "83Hz: %f\n", magnitudesDB[2]);
+      if (file->is_portable) {
+        flash_layer->set_opacity(FlashOpacity(magnitudesDB[2]));
+        compositor->Render(offscreen_canvas);
+      }
       offscreen_canvas = matrix->SwapOnVSync(offscreen_canvas, file->params.vsync_multiple);
       const tmillis_t time_already_spent = GetTimeInMillis() - start_wait_ms;
       SleepMillis(anim_delay_ms - time_already_spent);
@@ -476,6 +516,12 @@ int main(int argc, char *argv[]) {
 
   FrameCanvas *offscreen_canvas = matrix->CreateFrameCanvas();
 
+  // The video at the bottom, white flashes following the bass on top.
+  LayerCompositor compositor(matrix->width(), matrix->height());
+  Layer *video_layer = compositor.AddLayer();
+  Layer *flash_layer = compositor.AddLayer(Layer::BLEND_ADD, 0);
+  flash_layer->Fill(255, 255, 255);
+
   printf("Size: %dx%d. Hardware gpio mapping: %s\n",
          matrix->width(), matrix->height(), matrix_options.hardware_mapping);
 
@@ -513,6 +559,7 @@ int main(int argc, char *argv[]) {
       file_info->params = filename_params[filename];
       file_info->content_stream = new rgb_matrix::MemStreamIO();
       file_info->is_multi_frame = image_sequence.size() > 1;
+      file_info->is_portable = (global_stream_writer == NULL);
       rgb_matrix::StreamWriter out(file_info->content_stream);
       for (size_t i = 0; i < image_sequence.size(); ++i) {
         const Magick::Image &img = image_sequence[i];
@@ -523,7 +570,8 @@ int main(int argc, char *argv[]) {
           delay_time_us = file_info->params.wait_ms * 1000;  // single image.
         }
         if (delay_time_us <= 0) delay_time_us = 100 * 1000;  // 1/10sec
-        StoreInStream(img, delay_time_us, do_center, offscreen_canvas,
+        StoreInStream(img, delay_time_us, do_center, file_info->is_portable,
+                      offscreen_canvas,
                       global_stream_writer ? global_stream_writer : &out);
       }
     } else {
@@ -546,6 +594,7 @@ int main(int argc, char *argv[]) {
         }
         StreamReader reader(file_info->content_stream);
         if (reader.GetNext(offscreen_canvas, NULL)) {  // header+size ok
+          file_info->is_portable = reader.is_rgb();
           file_info->is_multi_frame = reader.GetNext(offscreen_canvas, NULL);
           reader.Rewind();
           if (global_stream_writer) {
@@ -616,7 +665,8 @@ int main(int argc, char *argv[]) {
       std::random_shuffle(file_imgs.begin(), file_imgs.end());
     }
     for (size_t i = 0; i < file_imgs.size() && !interrupt_received; ++i) {
-      DisplayAnimation(file_imgs[i], matrix, offscreen_canvas, pcm_handle);
+      DisplayAnimation(file_imgs[i], matrix, offscreen_canvas,
+                       &compositor, video_layer, flash_layer, pcm_handle);
     }
   } while (do_forever && !interrupt_received);
 
@@ -0,0 +1,93 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+// Feeds the beat tracker of music-synced/ with synthetic spectra: noise,
+// with one loud block per beat. Over the whole default tempo range it has
+// to lock on the right tempo, not half or double of it, and predict the
+// beats in time.
+//
+// Needs neither sound hardware nor a Pi; run 'make test' in the toplevel
+// directory.
+
+#include "beat-tracker.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const double kBlocksPerSecond = 44100.0 / 1024;
+static const int kBins = 512;
+static const double kSeconds = 20;
+
+static const double kMaxLockSeconds = 5;      // Time until locked.
+static const double kMaxBpmError = 0.01;      // Relative.
+static const double kMaxPhaseErrorMs = 45;    // About two blocks.
+
+static bool RunTempo(double bpm) {
+  BeatTracker tracker(kBlocksPerSecond);
+  const double beat_us = 60e6 / bpm;
+  const double block_us = 1e6 / kBlocksPerSecond;
+  const uint64_t start = 1000000000ull;
+  double magnitudes[kBins];
+
+  srand(8);
+  double lock_time = -1;
+  double max_phase_error = 0;
+  int next_beat = 0;
+  for (int block = 0; block < kSeconds * kBlocksPerSecond; ++block) {
+    const double block_start = block * block_us;
+    const uint64_t now = start + (uint64_t)block_start;
+    bool is_beat = false;
+    while (next_beat * beat_us < block_start + block_us) {
+      if (next_beat * beat_us >= block_start) is_beat = true;
+      ++next_beat;
+    }
+    const double level = is_beat ? 8 : 1;
+    for (int i = 0; i < kBins; ++i) {
+      const double noise = 0.5 + rand() / (double)RAND_MAX;
+      magnitudes[i] = level * 1000 * noise / (1 + i * 0.05);
+    }
+    tracker.Process(magnitudes, kBins, now);
+
+    if (!tracker.Locked()) continue;
+    const double seconds = block / kBlocksPerSecond;
+    if (lock_time < 0) lock_time = seconds;
+    if (seconds < lock_time + 2) continue;  // Let the beat clock settle.
+    double error = fmod(tracker.NextBeat(now) - start, beat_us);
+    if (error > beat_us / 2) error -= beat_us;
+    max_phase_error = fmax(max_phase_error, fabs(error) / 1000);
+  }
+
+  const bool ok = (lock_time >= 0 && lock_time <= kMaxLockSeconds
+                   && fabs(tracker.Bpm() / bpm - 1) <= kMaxBpmError
+                   && max_phase_error <= kMaxPhaseErrorMs);
+  if (!ok) {
+    fprintf(stderr, "%.0f bpm: locked after %.1fs at %.1f bpm, "
+            "phase off by up to %.0f ms\n", bpm, lock_time,
+            tracker.Locked() ? tracker.Bpm() : 0.0, max_phase_error);
+  }
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  int count = 0;
+  int failures = 0;
+  for (double bpm = 60; bpm <= 180; bpm += 5) {
+    ++count;
+    if (!RunTempo(bpm)) ++failures;
+  }
+  fprintf(stderr, "%d tempos, %d failures\n", count, failures);
+  return failures == 0 ? 0 : 1;
+}
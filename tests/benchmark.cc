@@ -0,0 +1,303 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+// Microbenchmarks of the canvas and framebuffer hot paths.
+//
+// Runs without root and without a Pi: the canvases come from a
+// FrameCanvasFactory, which needs no hardware. Every benchmark works on a
+// full frame per operation; we report the per-frame latency (median and
+// 99th percentile) and the throughput in pixels per second.
+//
+// Run 'make benchmark' in the toplevel directory, or tests/benchmark -h for
+// the options. Compare numbers taken on the same machine only.
+
+#include "led-matrix.h"
+#include "content-streamer.h"
+#include "graphics.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+using rgb_matrix::Canvas;
+using rgb_matrix::Color;
+using rgb_matrix::FrameCanvas;
+using rgb_matrix::FrameCanvasFactory;
+using rgb_matrix::RGBMatrix;
+using rgb_matrix::StreamIO;
+
+static int64_t NowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// StreamIO writing into a buffer of fixed size, starting over when full,
+// so that we can stream for as long as we like without running out of
+// memory.
+class ScratchStreamIO : public StreamIO {
+public:
+  explicit ScratchStreamIO(size_t size) : buffer_(size), pos_(0) {}
+
+  void Rewind() final { pos_ = 0; }
+  ssize_t Read(void *buf, size_t count) final { return -1; }
+  ssize_t Append(const void *buf, size_t count) final {
+    if (count > buffer_.size()) return -1;
+    if (pos_ + count > buffer_.size()) pos_ = 0;
+    memcpy(&buffer_[pos_], buf, count);
+    pos_ += count;
+    return count;
+  }
+
+private:
+  std::vector<char> buffer_;
+  size_t pos_;
+};
+
+struct BenchmarkConfig {
+  double seconds;         // Time to spend per benchmark.
+  const char *filter;     // Only run benchmarks containing this, if set.
+};
+
+// Run "op" repeatedly for the configured time and print the statistics.
+// "pixels" is the number of pixels one call to op touches.
+static void RunBenchmark(const BenchmarkConfig &config,
+                         const std::string &name, int pixels,
+                         const std::function<void()> &op) {
+  if (config.filter && name.find(config.filter) == std::string::npos)
+    return;
+
+  for (int i = 0; i < 3; ++i) op();  // Warm up caches.
+
+  std::vector<int64_t> samples;
+  const int64_t end = NowNanos() + (int64_t)(config.seconds * 1e9);
+  int64_t start = NowNanos();
+  int64_t total = 0;
+  do {
+    op();
+    const int64_t done = NowNanos();
+    samples.push_back(done - start);
+    total += done - start;
+    start = done;
+  } while (start < end || samples.size() < 10);
+
+  std::sort(samples.begin(), samples.end());
+  const double median_us = samples[samples.size() / 2] / 1000.0;
+  const double p99_us = samples[samples.size() * 99 / 100] / 1000.0;
+  const double mpix_per_sec = 1e3 * pixels * samples.size() / total;
+  printf("%-32s %9zu %11.2f %11.2f %11.2f\n", name.c_str(), samples.size(),
+         median_us, p99_us, mpix_per_sec);
+  fflush(stdout);
+}
+
+// Canvases of one configuration to run benchmarks on.
+struct Setup {
+  std::string name;
+  FrameCanvasFactory *factory;
+  FrameCanvas *canvas;
+};
+
+static bool CreateSetup(const std::string &name,
+                        const RGBMatrix::Options &options, Setup *setup) {
+  setup->name = name;
+  setup->factory = FrameCanvasFactory::Create(options);
+  if (setup->factory == NULL) return false;
+  setup->canvas = setup->factory->CreateFrameCanvas();
+  return true;
+}
+
+// Benchmarks of drawing pixels, which mostly depends on the pixel mapping.
+static void RunPixelBenchmarks(const BenchmarkConfig &config,
+                               const Setup &setup) {
+  FrameCanvas *const canvas = setup.canvas;
+  const int width = canvas->width();
+  const int height = canvas->height();
+  const int pixels = width * height;
+  const std::string prefix = setup.name + "/";
+
+  std::vector<Color> image(pixels);
+  for (int i = 0; i < pixels; ++i) {
+    image[i] = Color(i * 7, i * 13, i * 29);
+  }
+
+  RunBenchmark(config, prefix + "SetPixel", pixels, [&]() {
+      const Color *c = image.data();
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x, ++c) {
+          canvas->SetPixel(x, y, c->r, c->g, c->b);
+        }
+      }
+    });
+  RunBenchmark(config, prefix + "SetPixels", pixels, [&]() {
+      canvas->SetPixels(0, 0, width, height, image.data());
+    });
+  RunBenchmark(config, prefix + "Fill", pixels, [&]() {
+      canvas->Fill(0x12, 0x34, 0x56);
+    });
+  RunBenchmark(config, prefix + "Clear", pixels, [&]() {
+      canvas->Clear();
+    });
+}
+
+// Benchmarks that only depend on the size of the internal representation.
+static void RunFrameBenchmarks(const BenchmarkConfig &config,
+                               const Setup &setup, const char *bdf_font) {
+  FrameCanvas *const canvas = setup.canvas;
+  const int width = canvas->width();
+  const int height = canvas->height();
+  const int pixels = width * height;
+  const std::string prefix = setup.name + "/";
+
+  std::vector<uint8_t> rgb(pixels * 3);
+  for (size_t i = 0; i < rgb.size(); ++i) rgb[i] = i * 7;
+  RunBenchmark(config, prefix + "SetImage", pixels, [&]() {
+      rgb_matrix::SetImage(canvas, 0, 0, rgb.data(), rgb.size(),
+                           width, height, false);
+    });
+
+  rgb_matrix::Font font;
+  if (font.LoadFont(bdf_font)) {
+    const Color color(255, 255, 0);
+    const char *text = "The quick brown fox jumps over the lazy dog";
+    RunBenchmark(config, prefix + "DrawText", pixels, [&]() {
+        for (int y = font.baseline(); y < height; y += font.height()) {
+          rgb_matrix::DrawText(canvas, font, 0, y, color, NULL, text);
+        }
+      });
+  } else {
+    fprintf(stderr, "Couldn't load font '%s', skipping DrawText\n", bdf_font);
+  }
+
+  FrameCanvas *other = setup.factory->CreateFrameCanvas();
+  other->Fill(1, 2, 3);
+  RunBenchmark(config, prefix + "CopyFrom", pixels, [&]() {
+      canvas->CopyFrom(*other);
+    });
+
+  const char *data;
+  size_t len;
+  std::vector<char> serialized;
+  RunBenchmark(config, prefix + "Serialize", pixels, [&]() {
+      canvas->Serialize(&data, &len);
+      serialized.assign(data, data + len);
+    });
+  canvas->Serialize(&data, &len);
+  serialized.assign(data, data + len);
+  RunBenchmark(config, prefix + "Deserialize", pixels, [&]() {
+      canvas->Deserialize(serialized.data(), serialized.size());
+    });
+
+  // Each operation streams one frame.
+  ScratchStreamIO scratch(16 * len);
+  rgb_matrix::StreamWriter scratch_writer(&scratch);
+  RunBenchmark(config, prefix + "StreamWrite", pixels, [&]() {
+      scratch_writer.Stream(*canvas, 1000);
+    });
+
+  rgb_matrix::MemStreamIO stream;
+  rgb_matrix::StreamWriter writer(&stream);
+  for (int i = 0; i < 16; ++i) writer.Stream(*canvas, 1000);
+  rgb_matrix::StreamReader reader(&stream);
+  uint32_t hold_time_us;
+  RunBenchmark(config, prefix + "StreamRead", pixels, [&]() {
+      if (!reader.GetNext(other, &hold_time_us)) {
+        reader.Rewind();
+        reader.GetNext(other, &hold_time_us);
+      }
+    });
+}
+
+static int usage(const char *progname) {
+  fprintf(stderr, "usage: %s [options]\n", progname);
+  fprintf(stderr, "Benchmark the canvas and framebuffer operations.\n");
+  fprintf(stderr, "Options:\n"
+          "\t-r <rows>     : Panel rows (default: 64).\n"
+          "\t-c <cols>     : Panel columns (default: 64).\n"
+          "\t-C <chain>    : Chained panels (default: 2).\n"
+          "\t-P <parallel> : Parallel chains (default: 1).\n"
+          "\t-t <seconds>  : Time per benchmark (default: 0.5).\n"
+          "\t-f <bdf-font> : Font for DrawText (default: ../fonts/6x10.bdf).\n"
+          "\t-b <filter>   : Only run benchmarks with <filter> in the name.\n");
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  RGBMatrix::Options options;
+  options.rows = 64;
+  options.cols = 64;
+  options.chain_length = 2;
+  options.parallel = 1;
+
+  BenchmarkConfig config;
+  config.seconds = 0.5;
+  config.filter = NULL;
+  const char *bdf_font = "../fonts/6x10.bdf";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "r:c:C:P:t:f:b:h")) != -1) {
+    switch (opt) {
+    case 'r': options.rows = atoi(optarg); break;
+    case 'c': options.cols = atoi(optarg); break;
+    case 'C': options.chain_length = atoi(optarg); break;
+    case 'P': options.parallel = atoi(optarg); break;
+    case 't': config.seconds = atof(optarg); break;
+    case 'f': bdf_font = strdup(optarg); break;
+    case 'b': config.filter = strdup(optarg); break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+
+  // The mapper chains to compare. The U-mapper needs an even chain of at
+  // least four panels.
+  RGBMatrix::Options rotated = options;
+  rotated.pixel_mapper_config = "Rotate:90";
+  RGBMatrix::Options folded = options;
+  folded.chain_length = std::max(4, (options.chain_length + 1) / 2 * 2);
+  folded.pixel_mapper_config = "U-mapper;Rotate:180";
+  RGBMatrix::Options multiplexed = options;
+  multiplexed.multiplexing = 1;  // Stripe
+  multiplexed.pixel_mapper_config = "Mirror:H";
+
+  Setup plain, rotate, ufold, stripe;
+  if (!CreateSetup("plain", options, &plain)
+      || !CreateSetup("rotate", rotated, &rotate)
+      || !CreateSetup("u-rotate", folded, &ufold)
+      || !CreateSetup("stripe-mirror", multiplexed, &stripe)) {
+    return 1;
+  }
+
+  printf("%dx%d panels, chain %d, parallel %d: %dx%d pixels\n",
+         options.rows, options.cols, options.chain_length, options.parallel,
+         plain.canvas->width(), plain.canvas->height());
+  printf("%-32s %9s %11s %11s %11s\n", "benchmark", "frames",
+         "median-us", "p99-us", "Mpixel/s");
+  for (const Setup *setup : { &plain, &rotate, &ufold, &stripe }) {
+    RunPixelBenchmarks(config, *setup);
+  }
+  RunFrameBenchmarks(config, plain, bdf_font);
+
+  for (const Setup *setup : { &plain, &rotate, &ufold, &stripe }) {
+    delete setup->factory;
+  }
+  return 0;
+}
@@ -0,0 +1,685 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+// Regression test for the bits we send to the panels.
+//
+// Every scene is drawn twice: once as reference with nothing but
+// SetPixel() (the plain scalar path), once with the faster operations of
+// the FrameCanvas (SetPixels(), FillRect(), Fill(), Blit(), ...). The
+// resulting bitplanes have to be identical.
+//
+// In addition, a checksum of the bitplanes and of the GPIO writes that
+// DumpToMatrix() does for them is compared to the golden file, so that
+// changes of the output are noticed, e.g. of the bit order.
+//
+// This is done for all hardware mappings, multiplexers and row address
+// types. The test links a copy of the library built with SIMULATE_GPIO, so
+// it runs on any machine. Run 'make test' in the toplevel directory; if the
+// output changed intentionally, update the golden file with
+//   tests/golden-test -u
+
+#include "led-matrix.h"
+#include "graphics.h"
+
+#include "framebuffer-internal.h"
+#include "gpio.h"
+#include "hardware-mapping.h"
+#include "multiplex-mappers-internal.h"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+using rgb_matrix::Canvas;
+using rgb_matrix::Color;
+using rgb_matrix::Font;
+using rgb_matrix::FrameCanvas;
+using rgb_matrix::FrameCanvasFactory;
+using rgb_matrix::GPIO;
+using rgb_matrix::RGBMatrix;
+using rgb_matrix::internal::Framebuffer;
+using rgb_matrix::internal::PixelDesignatorMap;
+
+// Canvas that only does SetPixel() on the FrameCanvas; everything else
+// is done with it as well. This is our reference.
+class ScalarCanvas : public Canvas {
+public:
+  explicit ScalarCanvas(FrameCanvas *delegatee) : delegatee_(delegatee) {}
+
+  int width() const { return delegatee_->width(); }
+  int height() const { return delegatee_->height(); }
+  void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) {
+    delegatee_->SetPixel(x, y, red, green, blue);
+  }
+  void Clear() { Fill(0, 0, 0); }
+  void Fill(uint8_t red, uint8_t green, uint8_t blue) {
+    for (int y = 0; y < height(); ++y) {
+      for (int x = 0; x < width(); ++x) {
+        SetPixel(x, y, red, green, blue);
+      }
+    }
+  }
+
+private:
+  FrameCanvas *const delegatee_;
+};
+
+// Colors of the test pattern. Covers all bits of all colors.
+static Color Pattern(int x, int y) {
+  return Color(x * 37 + y * 3, y * 29 + x, (x ^ y) * 11);
+}
+
+// -- Scenes. Each is drawn on "c". If "frame" is set, it is the same
+// canvas and the FrameCanvas operations are to be used, with "other" as a
+// second canvas of the same factory; otherwise "c" is the reference and
+// these need to be done with SetPixel().
+
+typedef void (*SceneFun)(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                         const Font &font);
+
+static void DrawGradient(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                         const Font &font) {
+  std::vector<Color> pixels(c->width() * c->height());
+  for (int y = 0; y < c->height(); ++y) {
+    for (int x = 0; x < c->width(); ++x) {
+      pixels[y * c->width() + x] = Pattern(x, y);
+    }
+  }
+  c->SetPixels(0, 0, c->width(), c->height(), pixels.data());
+}
+
+static void DrawImages(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                       const Font &font) {
+  const int width = c->width() / 2 + 7;
+  const int height = c->height() / 2 + 5;
+  std::vector<uint8_t> image(width * height * 3);
+  for (size_t i = 0; i < image.size(); ++i) image[i] = i * 13;
+  rgb_matrix::SetImage(c, -3, -2, image.data(), image.size(),
+                       width, height, false);
+  rgb_matrix::SetImage(c, c->width() - width / 2, c->height() - height / 2,
+                       image.data(), image.size(), width, height, true);
+}
+
+static void DrawFill(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                     const Font &font) {
+  c->Fill(0x9c, 0x2d, 0xf1);
+}
+
+static void DrawClear(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                      const Font &font) {
+  DrawGradient(c, frame, other, font);
+  c->Clear();
+  c->SetPixel(1, 1, 255, 255, 255);
+}
+
+static void DrawRects(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                      const Font &font) {
+  c->FillRect(0, 0, c->width(), c->height(), 0x10, 0x20, 0x30);
+  c->FillRect(3, 2, 17, 9, 0xff, 0x80, 0x01);
+  c->FillRect(-5, c->height() - 4, 12, 10, 0x01, 0xfe, 0x7f);  // Clipped.
+  c->FillRect(c->width() - 6, -3, 20, 7, 0xaa, 0x55, 0xc3);    // Clipped.
+  c->FillRect(5, 5, 0, 3, 0xff, 0xff, 0xff);                   // Empty.
+  c->FillRect(c->width() / 3, 1, 1, c->height() - 2, 0x7e, 0x00, 0x81);
+}
+
+static void DrawShapes(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                       const Font &font) {
+  const Color red(255, 0, 0), gold(200, 170, 30), teal(0, 128, 128);
+  rgb_matrix::FillCircle(c, c->width() / 2, c->height() / 2,
+                         c->height() / 3, gold);
+  rgb_matrix::DrawCircle(c, 4, 4, 9, red);
+  const int xs[] = { 2, c->width() - 3, c->width() / 2 };
+  const int ys[] = { c->height() - 2, c->height() - 9, 3 };
+  rgb_matrix::FillPolygon(c, xs, ys, 3, teal);
+  rgb_matrix::DrawLine(c, 0, c->height() - 1, c->width() - 1, 0, red);
+  rgb_matrix::DrawText(c, font, 1, font.baseline(), gold, &teal,
+                       "Golden 0123 \xc3\xa4\xc3\xb6");
+  rgb_matrix::VerticalDrawText(c, font, c->width() - font.CharacterWidth('X'),
+                               font.height(), red, NULL, "Hi");
+}
+
+// Copy the "width" x "height" rectangle at "src_x", "src_y" of the test
+// pattern to "dst_x", "dst_y" with SetPixel(), clipped like Blit() does.
+static void BlitPattern(Canvas *c, int src_x, int src_y, int width, int height,
+                        int dst_x, int dst_y) {
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int sx = src_x + x, sy = src_y + y;
+      const int dx = dst_x + x, dy = dst_y + y;
+      if (sx < 0 || sy < 0 || sx >= c->width() || sy >= c->height()
+          || dx < 0 || dy < 0 || dx >= c->width() || dy >= c->height())
+        continue;
+      const Color color = Pattern(sx, sy);
+      c->SetPixel(dx, dy, color.r, color.g, color.b);
+    }
+  }
+}
+
+static void DrawBlits(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                      const Font &font) {
+  struct { int src_x, src_y, width, height, dst_x, dst_y; } const blits[] = {
+    { 0, 0, 9, 7, 20, 3 },
+    { 5, 3, c->width(), c->height(), -2, 1 },              // Clipped.
+    { -4, -1, 8, 6, c->width() - 5, c->height() - 3 },     // Clipped.
+  };
+  if (frame) BlitPattern(other, 0, 0, c->width(), c->height(), 0, 0);
+  c->Fill(0x33, 0x66, 0x99);
+  for (const auto &b : blits) {
+    if (frame) {
+      frame->Blit(*other, b.src_x, b.src_y, b.width, b.height,
+                  b.dst_x, b.dst_y);
+    } else {
+      BlitPattern(c, b.src_x, b.src_y, b.width, b.height, b.dst_x, b.dst_y);
+    }
+  }
+}
+
+// Overlapping blits within the same canvas, in all directions; each in
+// its own quarter of the canvas, so that they don't see each other.
+static void DrawSelfBlits(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                          const Font &font) {
+  const int w = c->width() / 2, h = c->height() / 2;
+  const int moves[][2] = { { 3, 2 }, { -3, 2 }, { 3, -2 }, { -3, -2 } };
+  BlitPattern(c, 0, 0, c->width(), c->height(), 0, 0);
+  for (int i = 0; i < 4; ++i) {
+    const int x = (i % 2) * w + 4, y = (i / 2) * h + 4;
+    const int dx = moves[i][0], dy = moves[i][1];
+    if (frame) {
+      frame->Blit(*frame, x, y, w - 8, h - 8, x + dx, y + dy);
+    } else {
+      BlitPattern(c, x, y, w - 8, h - 8, x + dx, y + dy);
+    }
+  }
+}
+
+static void DrawScroll(Canvas *c, FrameCanvas *frame, FrameCanvas *other,
+                       const Font &font) {
+  const int dx = -5, dy = 3;
+  if (frame) {
+    BlitPattern(c, 0, 0, c->width(), c->height(), 0, 0);
+    frame->ScrollBy(dx, dy);
+  } else {
+    BlitPattern(c, 0, 0, c->width(), c->height(), dx, dy);
+  }
+}
+
+struct Scene {
+  const char *name;
+  SceneFun draw;
+  bool copies;  // Reads back pixels, so needs a one-to-one pixel mapping.
+};
+
+static const Scene kScenes[] = {
+  { "gradient", DrawGradient, false },
+  { "images", DrawImages, false },
+  { "fill", DrawFill, false },
+  { "clear", DrawClear, false },
+  { "rects", DrawRects, false },
+  { "shapes", DrawShapes, false },
+  { "blits", DrawBlits, true },
+  { "self-blits", DrawSelfBlits, true },
+  { "scroll", DrawScroll, true },
+};
+
+// The color bits of each parallel chain of the hardware mapping.
+static std::vector<gpio_bits_t> ChainColorBits(const char *hardware_mapping) {
+  const HardwareMapping *h = matrix_hardware_mappings;
+  while (strcasecmp(h->name, hardware_mapping) != 0) ++h;
+  const gpio_bits_t chains[6] = {
+    h->p0_r1 | h->p0_g1 | h->p0_b1 | h->p0_r2 | h->p0_g2 | h->p0_b2,
+    h->p1_r1 | h->p1_g1 | h->p1_b1 | h->p1_r2 | h->p1_g2 | h->p1_b2,
+    h->p2_r1 | h->p2_g1 | h->p2_b1 | h->p2_r2 | h->p2_g2 | h->p2_b2,
+    h->p3_r1 | h->p3_g1 | h->p3_b1 | h->p3_r2 | h->p3_g2 | h->p3_b2,
+    h->p4_r1 | h->p4_g1 | h->p4_b1 | h->p4_r2 | h->p4_g2 | h->p4_b2,
+    h->p5_r1 | h->p5_g1 | h->p5_b1 | h->p5_r2 | h->p5_g2 | h->p5_b2,
+  };
+  std::vector<gpio_bits_t> result;
+  for (int i = 0; i < 6 && chains[i] != 0; ++i) result.push_back(chains[i]);
+  return result;
+}
+
+// The color bits that are clocked out to the panels.
+static gpio_bits_t OutputColorBits(const RGBMatrix::Options &options) {
+  const std::vector<gpio_bits_t> chains =
+    ChainColorBits(options.hardware_mapping);
+  gpio_bits_t result = 0;
+  for (int i = 0; i < options.parallel; ++i) result |= chains[i];
+  return result;
+}
+
+struct TestConfig {
+  std::string name;
+  RGBMatrix::Options options;
+  // If set, another FrameCanvasFactory with this hardware mapping is
+  // created after the GPIO is set up; it must not change our output.
+  const char *other_hardware_mapping = nullptr;
+};
+
+static std::vector<TestConfig> CreateConfigs() {
+  RGBMatrix::Options base;
+  base.rows = 32;
+  base.cols = 64;
+  base.chain_length = 2;
+  base.hardware_mapping = "regular";
+
+  std::vector<TestConfig> result;
+  // All parallel chains, as far as the options allow.
+  for (const HardwareMapping *h = matrix_hardware_mappings; h->name; ++h) {
+    TestConfig config = { std::string("hardware=") + h->name, base };
+    config.options.hardware_mapping = h->name;
+    config.options.parallel = std::min(3, (int)ChainColorBits(h->name).size());
+    result.push_back(config);
+  }
+
+  // Most outdoor panels the multiplexers are made for are 32x16; the ones
+  // named after that size don't work with any other.
+  const rgb_matrix::internal::MuxMapperList &muxers =
+    rgb_matrix::internal::GetRegisteredMultiplexMappers();
+  for (size_t i = 0; i < muxers.size(); ++i) {
+    const std::string name = muxers[i]->GetName();
+    TestConfig config = { "multiplexing=" + name, base };
+    config.options.multiplexing = i + 1;
+    if (name.find("32x16") == std::string::npos) {
+      result.push_back(config);
+    }
+    config.name += "-32x16";
+    config.options.rows = 16;
+    config.options.cols = 32;
+    result.push_back(config);
+  }
+
+  for (int type = 0; type <= 4; ++type) {
+    TestConfig config = { "row-address=" + std::to_string(type), base };
+    config.options.rows = 64;
+    config.options.row_address_type = type;
+    result.push_back(config);
+  }
+
+  TestConfig config = { "rows=16", base };
+  config.options.rows = 16;
+  result.push_back(config);
+
+  config = { "interlaced", base };
+  config.options.scan_mode = 1;
+  result.push_back(config);
+
+  config = { "inverse-bgr", base };
+  config.options.inverse_colors = true;
+  config.options.led_rgb_sequence = "BGR";
+  result.push_back(config);
+
+  config = { "pwm-bits=7-brightness=40", base };
+  config.options.pwm_bits = 7;
+  config.options.brightness = 40;
+  result.push_back(config);
+
+  config = { "mapper=U-mapper;Rotate:90", base };
+  config.options.chain_length = 4;
+  config.options.pixel_mapper_config = "U-mapper;Rotate:90";
+  result.push_back(config);
+
+  config = { "mapper=Rotate:90", base };
+  config.options.pixel_mapper_config = "Rotate:90";
+  result.push_back(config);
+
+  config = { "mapper=Rotate:270-parallel=2", base };
+  config.options.parallel = 2;
+  config.options.pixel_mapper_config = "Rotate:270";
+  result.push_back(config);
+
+  config = { "other-factory=adafruit-hat", base };
+  config.other_hardware_mapping = "adafruit-hat";
+  result.push_back(config);
+
+  config = { "mapper=Mirror:H", base };
+  config.options.pixel_mapper_config = "Mirror:H";
+  result.push_back(config);
+
+  return result;
+}
+
+static std::vector<gpio_bits_t> Bitplanes(const FrameCanvas &canvas) {
+  const char *data;
+  size_t len;
+  canvas.Serialize(&data, &len);
+  std::vector<gpio_bits_t> result(len / sizeof(gpio_bits_t));
+  memcpy(result.data(), data, len);
+  return result;
+}
+
+// Mask of the framebuffer bits that belong to pixels reachable with
+// SetPixel(). The framebuffer has other bits that the faster operations
+// might set, which is fine: Fill() sets the color bits of all parallel
+// chains the hardware mapping supports, but only the ones in use are
+// clocked out. And multiplexers don't necessarily use all physical
+// pixels; Fill() covers those as well.
+static std::vector<gpio_bits_t> ReachableBits(FrameCanvas *canvas,
+                                              int columns,
+                                              gpio_bits_t color_bits) {
+  canvas->Clear();
+  const std::vector<gpio_bits_t> cleared = Bitplanes(*canvas);
+  for (int y = 0; y < canvas->height(); ++y) {
+    for (int x = 0; x < canvas->width(); ++x) {
+      canvas->SetPixel(x, y, 255, 255, 255);
+    }
+  }
+  const std::vector<gpio_bits_t> white = Bitplanes(*canvas);
+
+  // Layout: per double row, all bitplanes of all columns.
+  const int planes = Framebuffer::kBitPlanes;
+  std::vector<gpio_bits_t> result(white.size());
+  for (size_t row = 0; row < white.size(); row += planes * columns) {
+    for (int col = 0; col < columns; ++col) {
+      gpio_bits_t reachable = 0;
+      for (int b = 0; b < planes; ++b) {
+        const size_t i = row + b * columns + col;
+        reachable |= white[i] ^ cleared[i];
+      }
+      for (int b = 0; b < planes; ++b) {
+        result[row + b * columns + col] = reachable & color_bits;
+      }
+    }
+  }
+  return result;
+}
+
+// Returns if every pixel has framebuffer bits of its own. Some
+// multiplexers only are that for the panel size they are made for;
+// otherwise some pixels share bits or are not shown at all, and copying
+// pixels around is not expected to give the same result as SetPixel().
+static bool IsOneToOne(FrameCanvas *canvas) {
+  canvas->Clear();
+  const std::vector<gpio_bits_t> cleared = Bitplanes(*canvas);
+  std::vector<gpio_bits_t> used(cleared.size());
+  for (int y = 0; y < canvas->height(); ++y) {
+    for (int x = 0; x < canvas->width(); ++x) {
+      canvas->SetPixel(x, y, 255, 255, 255);
+      const std::vector<gpio_bits_t> lit = Bitplanes(*canvas);
+      canvas->SetPixel(x, y, 0, 0, 0);
+      bool any = false;
+      for (size_t i = 0; i < lit.size(); ++i) {
+        const gpio_bits_t bits = lit[i] ^ cleared[i];
+        if (bits & used[i]) return false;
+        used[i] |= bits;
+        any |= (bits != 0);
+      }
+      if (!any) return false;
+    }
+  }
+  return true;
+}
+
+// Bitplanes of the canvas, reduced to the bits we compare.
+static std::vector<gpio_bits_t> MaskedBitplanes(
+  const FrameCanvas &canvas, const std::vector<gpio_bits_t> &mask) {
+  std::vector<gpio_bits_t> result = Bitplanes(canvas);
+  for (size_t i = 0; i < result.size(); ++i) result[i] &= mask[i];
+  return result;
+}
+
+static uint64_t HashBytes(const void *data, size_t len,
+                          uint64_t hash = 0xcbf29ce484222325ULL) {
+  const uint8_t *bytes = (const uint8_t *) data;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Run all scenes for the given configuration; prints a result line for
+// each to "out". Returns the number of scenes in which the reference and the
+// faster operations disagree.
+//
+// Needs to run in its own process: the GPIO setup of the library can only
+// be done once.
+static int RunConfig(const TestConfig &config, const Font &font, FILE *out) {
+  // Some multiplexers complain about every pixel they can't map at the
+  // panel sizes we test. IsOneToOne() covers that; keep the output short.
+  fflush(stderr);
+  const int saved_stderr = dup(STDERR_FILENO);
+  const int devnull = open("/dev/null", O_WRONLY);
+  dup2(devnull, STDERR_FILENO);
+  close(devnull);
+  FrameCanvasFactory *factory = FrameCanvasFactory::Create(config.options);
+  dup2(saved_stderr, STDERR_FILENO);
+  close(saved_stderr);
+  if (factory == NULL) {
+    fprintf(stderr, "%s: invalid options\n", config.name.c_str());
+    return 1;
+  }
+  FrameCanvas *reference = factory->CreateFrameCanvas();
+  FrameCanvas *canvas = factory->CreateFrameCanvas();
+  FrameCanvas *other = factory->CreateFrameCanvas();
+
+  // To see the GPIO writes, we need a Framebuffer as the refresh thread
+  // has it: with the physical geometry of the panels.
+  const RGBMatrix::Options &opt = config.options;
+  int rows = opt.rows, cols = opt.cols;
+  if (opt.multiplexing > 0) {
+    rgb_matrix::internal::GetRegisteredMultiplexMappers()[opt.multiplexing - 1]
+      ->EditColsRows(&cols, &rows);
+  }
+  PixelDesignatorMap *dump_mapper = NULL;
+  Framebuffer dump(rows, cols * opt.chain_length, opt.parallel, opt.scan_mode,
+                   opt.led_rgb_sequence, opt.inverse_colors,
+                   Framebuffer::FindHardwareMapping(opt.hardware_mapping),
+                   &dump_mapper);
+  dump.SetPWMBits(opt.pwm_bits);
+  GPIO io;
+  io.Init(0);
+  Framebuffer::InitGPIO(&io, dump.hardware_mapping(), rows, opt.parallel, true,
+                        opt.pwm_lsb_nanoseconds, opt.pwm_dither_bits,
+                        opt.row_address_type);
+
+  // Like a headless renderer next to a running matrix: the canvases of
+  // another factory have their own hardware mapping.
+  FrameCanvasFactory *other_factory = NULL;
+  if (config.other_hardware_mapping) {
+    dump.Fill(255, 255, 255);
+    io.trace()->clear();
+    dump.DumpToMatrix(&io, 0);
+    const std::vector<GPIO::TraceEvent> before = *io.trace();
+
+    RGBMatrix::Options other_options = opt;
+    other_options.hardware_mapping = config.other_hardware_mapping;
+    other_factory = FrameCanvasFactory::Create(other_options);
+    other_factory->CreateFrameCanvas()->Fill(255, 255, 255);
+
+    io.trace()->clear();
+    dump.DumpToMatrix(&io, 0);
+    const std::vector<GPIO::TraceEvent> &after = *io.trace();
+    if (after.size() != before.size()
+        || !std::equal(before.begin(), before.end(), after.begin(),
+                       [](const GPIO::TraceEvent &a, const GPIO::TraceEvent &b) {
+                         return a.op == b.op && a.bits == b.bits;
+                       })) {
+      fprintf(stderr, "%s: GPIO writes changed by other factory\n",
+              config.name.c_str());
+      delete other_factory;
+      delete factory;
+      return 1;
+    }
+  }
+
+  const std::vector<gpio_bits_t> mask =
+    ReachableBits(other, cols * opt.chain_length, OutputColorBits(opt));
+  const bool one_to_one = IsOneToOne(other);
+  int failures = 0;
+  for (const Scene &scene : kScenes) {
+    ScalarCanvas scalar(reference);
+    reference->Clear();
+    scene.draw(&scalar, NULL, NULL, font);
+
+    canvas->Clear();
+    other->Clear();
+    scene.draw(canvas, canvas, other, font);
+
+    const std::vector<gpio_bits_t> expected = MaskedBitplanes(*reference, mask);
+    if ((one_to_one || !scene.copies)
+        && MaskedBitplanes(*canvas, mask) != expected) {
+      fprintf(stderr, "%s %s: bitplanes differ from SetPixel() reference\n",
+              config.name.c_str(), scene.name);
+      ++failures;
+    }
+
+    io.trace()->clear();
+    const char *data;
+    size_t len;
+    reference->Serialize(&data, &len);
+    dump.Deserialize(data, len);
+    dump.DumpToMatrix(&io, 0);
+    const std::vector<GPIO::TraceEvent> &trace = *io.trace();
+    uint64_t trace_hash = HashBytes(NULL, 0);
+    for (const GPIO::TraceEvent &event : trace) {
+      trace_hash = HashBytes(&event.op, sizeof(event.op), trace_hash);
+      trace_hash = HashBytes(&event.bits, sizeof(event.bits), trace_hash);
+    }
+    fprintf(out, "%s %s %016llx %016llx\n", config.name.c_str(), scene.name,
+            (unsigned long long) HashBytes(expected.data(),
+                                           expected.size() * sizeof(gpio_bits_t)),
+            (unsigned long long) trace_hash);
+  }
+  delete other_factory;
+  delete factory;
+  return failures;
+}
+
+// Run configuration in a child process; appends its result lines.
+static int RunConfigInChild(const TestConfig &config, const Font &font,
+                            std::vector<std::string> *lines) {
+  int fds[2];
+  if (pipe(fds) < 0) {
+    perror("pipe()");
+    return 1;
+  }
+  fflush(stdout);
+  fflush(stderr);
+  const pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    FILE *out = fdopen(fds[1], "w");
+    const int failures = RunConfig(config, font, out);
+    fclose(out);
+    _exit(failures > 100 ? 100 : failures);
+  }
+  close(fds[1]);
+  FILE *in = fdopen(fds[0], "r");
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), in)) {
+    lines->push_back(buffer);
+  }
+  fclose(in);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status)) {
+    fprintf(stderr, "%s: crashed\n", config.name.c_str());
+    return 1;
+  }
+  return WEXITSTATUS(status);
+}
+
+static int usage(const char *progname) {
+  fprintf(stderr, "usage: %s [options]\n", progname);
+  fprintf(stderr, "Compare the framebuffer output with the reference and "
+          "the golden file.\n");
+  fprintf(stderr, "Options:\n"
+          "\t-g <file>     : Golden file (default: golden-test.golden).\n"
+          "\t-f <bdf-font> : Font for the text (default: ../fonts/5x7.bdf).\n"
+          "\t-u            : Update the golden file instead of comparing.\n");
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  const char *golden_file = "golden-test.golden";
+  const char *bdf_font = "../fonts/5x7.bdf";
+  bool update = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "g:f:uh")) != -1) {
+    switch (opt) {
+    case 'g': golden_file = strdup(optarg); break;
+    case 'f': bdf_font = strdup(optarg); break;
+    case 'u': update = true; break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+
+  Font font;
+  if (!font.LoadFont(bdf_font)) {
+    fprintf(stderr, "Couldn't load font '%s'\n", bdf_font);
+    return 1;
+  }
+
+  int failures = 0;
+  std::vector<std::string> lines;
+  for (const TestConfig &config : CreateConfigs()) {
+    failures += RunConfigInChild(config, font, &lines);
+  }
+
+  if (update) {
+    FILE *f = fopen(golden_file, "w");
+    if (f == NULL) {
+      perror(golden_file);
+      return 1;
+    }
+    fprintf(f, "# <config> <scene> <bitplane-hash> <gpio-trace-hash>\n"
+            "# Generated by golden-test -u\n");
+    for (const std::string &line : lines) fputs(line.c_str(), f);
+    fclose(f);
+    fprintf(stderr, "Wrote %d results to %s\n", (int)lines.size(),
+            golden_file);
+    return failures == 0 ? 0 : 1;
+  }
+
+  // Lines are keyed by config and scene, i.e. the first two words.
+  std::map<std::string, std::string> golden;
+  FILE *f = fopen(golden_file, "r");
+  if (f == NULL) {
+    perror(golden_file);
+    return 1;
+  }
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), f)) {
+    if (buffer[0] == '#') continue;
+    const std::string line = buffer;
+    golden[line.substr(0, line.find(' ', line.find(' ') + 1))] = line;
+  }
+  fclose(f);
+
+  for (const std::string &line : lines) {
+    const std::string key = line.substr(0, line.find(' ', line.find(' ') + 1));
+    const auto found = golden.find(key);
+    if (found == golden.end()) {
+      fprintf(stderr, "%s: not in golden file\n", key.c_str());
+      ++failures;
+    } else if (found->second != line) {
+      fprintf(stderr, "%s: output differs from golden file\n", key.c_str());
+      ++failures;
+    }
+  }
+
+  fprintf(stderr, "%d results, %d failures\n", (int)lines.size(), failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+// Round trip of the "File" pixel mapper: a table written with
+// WritePixelMapperFile() has to map every pixel to the same place as the
+// pixel mappers it was generated from.
+//
+// Runs without root and without a Pi; run 'make test' in the toplevel
+// directory.
+
+#include "led-matrix.h"
+#include "pixel-mapper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+using rgb_matrix::FrameCanvas;
+using rgb_matrix::FrameCanvasFactory;
+using rgb_matrix::RGBMatrix;
+
+struct TestConfig {
+  const char *pixel_mapper_config;
+  int chain_length;
+  int parallel;
+  int multiplexing;
+};
+
+static const TestConfig kConfigs[] = {
+  { "Rotate:90", 2, 1, 0 },
+  { "U-mapper;Rotate:90", 4, 1, 0 },
+  { "Rotate:270", 2, 2, 0 },
+  { "V-mapper:Z", 2, 3, 0 },
+  { "Mirror:H;Rotate:180", 3, 1, 0 },
+  { "Rotate:90", 2, 1, 1 },
+};
+
+// Every pixel gets its own color, so the serialized frames only are the
+// same if all pixels end up at the same place.
+static std::string Render(const RGBMatrix::Options &options) {
+  FrameCanvasFactory *factory = FrameCanvasFactory::Create(options);
+  if (factory == NULL) return "";
+  FrameCanvas *canvas = factory->CreateFrameCanvas();
+  for (int y = 0; y < canvas->height(); ++y) {
+    for (int x = 0; x < canvas->width(); ++x) {
+      canvas->SetPixel(x, y, x, y, 255 - x - y);
+    }
+  }
+  const char *data;
+  size_t len;
+  canvas->Serialize(&data, &len);
+  char size[32];
+  snprintf(size, sizeof(size), "%dx%d:", canvas->width(), canvas->height());
+  const std::string result = size + std::string(data, len);
+  delete factory;
+  return result;
+}
+
+static bool RunConfig(const TestConfig &config, const char *filename) {
+  RGBMatrix::Options options;
+  options.rows = 32;
+  options.cols = 64;
+  options.chain_length = config.chain_length;
+  options.parallel = config.parallel;
+  options.multiplexing = config.multiplexing;
+  options.hardware_mapping = "regular";
+
+  // The table is for the matrix with multiplexing, before any mappers.
+  FrameCanvasFactory *plain = FrameCanvasFactory::Create(options);
+  if (plain == NULL) return false;
+  const int width = plain->width();
+  const int height = plain->height();
+  delete plain;
+  if (!rgb_matrix::WritePixelMapperFile(filename, config.pixel_mapper_config,
+                                        options.chain_length, options.parallel,
+                                        width, height)) {
+    fprintf(stderr, "%s: could not write mapping file\n",
+            config.pixel_mapper_config);
+    return false;
+  }
+
+  options.pixel_mapper_config = config.pixel_mapper_config;
+  const std::string expected = Render(options);
+  const std::string file_config = std::string("File:") + filename;
+  options.pixel_mapper_config = file_config.c_str();
+  const std::string result = Render(options);
+  if (expected.empty() || result != expected) {
+    fprintf(stderr, "%s (chain=%d, parallel=%d, multiplexing=%d): "
+            "File mapper differs\n", config.pixel_mapper_config,
+            config.chain_length, config.parallel, config.multiplexing);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  char filename[] = "/tmp/pixel-mapper-file-test-XXXXXX";
+  const int fd = mkstemp(filename);
+  if (fd < 0) {
+    perror("mkstemp()");
+    return 1;
+  }
+  close(fd);
+
+  const int count = sizeof(kConfigs) / sizeof(kConfigs[0]);
+  int failures = 0;
+  for (int i = 0; i < count; ++i) {
+    if (!RunConfig(kConfigs[i], filename)) ++failures;
+  }
+  unlink(filename);
+
+  fprintf(stderr, "%d mappings, %d failures\n", count, failures);
+  return failures == 0 ? 0 : 1;
+}
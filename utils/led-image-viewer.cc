@@ -23,8 +23,10 @@
 #include "pixel-mapper.h"
 #include "content-streamer.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <math.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,14 +37,20 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <Magick++.h>
 #include <magick/image.h>
 
 using rgb_matrix::Canvas;
+using rgb_matrix::Color;
 using rgb_matrix::FrameCanvas;
 using rgb_matrix::RGBMatrix;
 using rgb_matrix::StreamReader;
@@ -86,30 +94,41 @@ static void SleepMillis(tmillis_t milli_seconds) {
 }
 
 static void StoreInStream(const Magick::Image &img, int delay_time_us,
-                          bool do_center,
+                          bool do_center, bool portable,
                           rgb_matrix::FrameCanvas *scratch,
                           rgb_matrix::StreamWriter *output) {
-  scratch->Clear();
-  const int x_offset = do_center ? (scratch->width() - img.columns()) / 2 : 0;
-  const int y_offset = do_center ? (scratch->height() - img.rows()) / 2 : 0;
+  const int width = scratch->width();
+  const int height = scratch->height();
+  const int x_offset = do_center ? (width - img.columns()) / 2 : 0;
+  const int y_offset = do_center ? (height - img.rows()) / 2 : 0;
+  std::vector<Color> pixels(width * height);
   for (size_t y = 0; y < img.rows(); ++y) {
+    const int py = y + y_offset;
+    if (py < 0 || py >= height) continue;
     for (size_t x = 0; x < img.columns(); ++x) {
+      const int px = x + x_offset;
+      if (px < 0 || px >= width) continue;
       const Magick::Color &c = img.pixelColor(x, y);
       if (c.alphaQuantum() < 255) {
-        scratch->SetPixel(x + x_offset, y + y_offset,
-                          ScaleQuantumToChar(c.redQuantum()),
-                          ScaleQuantumToChar(c.greenQuantum()),
-                          ScaleQuantumToChar(c.blueQuantum()));
+        pixels[py * width + px] = Color(ScaleQuantumToChar(c.redQuantum()),
+                                        ScaleQuantumToChar(c.greenQuantum()),
+                                        ScaleQuantumToChar(c.blueQuantum()));
       }
     }
   }
-  output->Stream(*scratch, delay_time_us);
+  if (portable) {
+    output->StreamRGB(pixels.data(), width, height, delay_time_us);
+  } else {
+    scratch->SetPixels(0, 0, width, height, pixels.data());
+    output->Stream(*scratch, delay_time_us);
+  }
 }
 
 static void CopyStream(rgb_matrix::StreamReader *r,
                        rgb_matrix::StreamWriter *w,
                        rgb_matrix::FrameCanvas *scratch) {
   uint32_t delay_us;
+  r->SetLoopSegments(false);  // Forever-loops would never finish.
   while (r->GetNext(scratch, &delay_us)) {
     w->Stream(*scratch, delay_us);
   }
@@ -173,6 +192,297 @@ static bool LoadImageAndScale(const char *filename,
   return true;
 }
 
+// Settings that are the same for all files being loaded.
+struct LoadSettings {
+  int width, height;           // Matrix size.
+  bool fill_width, fill_height;
+  bool do_center;
+  bool do_mmap;
+  bool portable;               // With stream output: write portable stream.
+  const char *cache_dir;       // If set, cache converted images here.
+  uint64_t config_fingerprint; // Identifies the panel configuration.
+};
+
+// 64-bit FNV-1a.
+static uint64_t HashBytes(const void *data, size_t len,
+                          uint64_t hash = 0xcbf29ce484222325ULL) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Native streams depend on everything that influences the framebuffer
+// representation: size, wiring, pixel mapper, rgb sequence, PWM bits,
+// brightness etc. Rather than listing all of these, draw a test pattern and
+// hash the resulting internal representation.
+static uint64_t ConfigFingerprint(FrameCanvas *scratch) {
+  const int width = scratch->width();
+  const int height = scratch->height();
+  std::vector<Color> pattern(width * height);
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    pattern[i] = Color(i * 37 + 1, i * 59 + 2, i * 83 + 3);
+  }
+  scratch->SetPixels(0, 0, width, height, pattern.data());
+  const char *data;
+  size_t len;
+  scratch->Serialize(&data, &len);
+  uint64_t hash = HashBytes(data, len);
+  hash = HashBytes(&width, sizeof(width), hash);
+  return HashBytes(&height, sizeof(height), hash);
+}
+
+// Name of the cache file for "filename" shown with "params", derived from
+// its content and everything else that goes into the converted stream.
+// Returns an empty string if the file can't be read.
+static std::string CacheFilename(const char *filename,
+                                 const ImageParams &params,
+                                 const LoadSettings &settings) {
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) return "";
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  char buffer[65536];
+  ssize_t r;
+  while ((r = read(fd, buffer, sizeof(buffer))) > 0) {
+    hash = HashBytes(buffer, r, hash);
+  }
+  close(fd);
+  if (r < 0) return "";
+
+  const int kCacheVersion = 1;
+  const int64_t settings_key[] = {
+    kCacheVersion, settings.fill_width, settings.fill_height,
+    settings.do_center, params.wait_ms,
+  };
+  hash = HashBytes(settings_key, sizeof(settings_key), hash);
+  hash = HashBytes(&settings.config_fingerprint,
+                   sizeof(settings.config_fingerprint), hash);
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.stream", (unsigned long long)hash);
+  return settings.cache_dir + std::string(name);
+}
+
+// Store the content of "stream" in "cache_file". Written to a temporary
+// file first, so that concurrent viewers never see a partial file.
+static void WriteCacheFile(rgb_matrix::StreamIO *stream,
+                           const std::string &cache_file) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%d.%lx.tmp", (int)getpid(),
+           (unsigned long)pthread_self());
+  const std::string tmp_file = cache_file + suffix;
+  const int fd = open(tmp_file.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0644);
+  if (fd < 0) {
+    perror("Can't write to cache");
+    return;
+  }
+  bool success = true;
+  char buffer[65536];
+  ssize_t r;
+  stream->Rewind();
+  while (success && (r = stream->Read(buffer, sizeof(buffer))) > 0) {
+    success = (write(fd, buffer, r) == r);
+  }
+  stream->Rewind();
+  success &= (close(fd) == 0);
+  if (!success || rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+    perror("Can't write to cache");
+    unlink(tmp_file.c_str());
+  }
+}
+
+static rgb_matrix::StreamIO *OpenStreamFile(int fd, bool do_mmap) {
+  if (do_mmap) {
+    rgb_matrix::MemMapViewInput *stream_input =
+      new rgb_matrix::MemMapViewInput(fd);
+    if (stream_input->IsInitialized()) {
+      return stream_input;
+    }
+    delete stream_input;
+  }
+  return new rgb_matrix::FileStreamIO(fd);
+}
+
+// Open a previously converted image from the cache. Returns NULL if it is
+// not there or not readable with our panel configuration.
+static FileInfo *OpenCached(const std::string &cache_file,
+                            const ImageParams &params, bool do_mmap,
+                            FrameCanvas *scratch) {
+  const int fd = open(cache_file.c_str(), O_RDONLY);
+  if (fd < 0) return NULL;
+  FileInfo *file_info = new FileInfo();
+  file_info->params = params;
+  if (do_mmap) {
+    file_info->content_stream = OpenStreamFile(fd, true);
+  } else {
+    // Keep in memory like freshly converted images; a long playlist would
+    // otherwise keep a file open for each.
+    file_info->content_stream = new rgb_matrix::MemStreamIO();
+    char buffer[65536];
+    ssize_t r;
+    while ((r = read(fd, buffer, sizeof(buffer))) > 0) {
+      file_info->content_stream->Append(buffer, r);
+    }
+    close(fd);
+  }
+  StreamReader reader(file_info->content_stream);
+  if (!reader.GetNext(scratch, NULL)) {
+    delete file_info->content_stream;
+    delete file_info;
+    return NULL;
+  }
+  file_info->is_multi_frame = reader.GetNext(scratch, NULL);
+  reader.Rewind();
+  return file_info;
+}
+
+// Load image or stream file "filename" and convert it for our panel.
+// If "stream_writer" is given, the result is appended to that stream.
+// Returns NULL and sets "err_msg" if it can't be loaded.
+static FileInfo *LoadFile(const char *filename, const ImageParams &params,
+                          const LoadSettings &settings,
+                          FrameCanvas *scratch,
+                          rgb_matrix::StreamWriter *stream_writer,
+                          std::string *err_msg) {
+  std::string cache_file;
+  if (settings.cache_dir && !stream_writer) {
+    cache_file = CacheFilename(filename, params, settings);
+    if (!cache_file.empty()) {
+      FileInfo *cached = OpenCached(cache_file, params, settings.do_mmap,
+                                    scratch);
+      if (cached) return cached;
+    }
+  }
+
+  FileInfo *file_info = NULL;
+  std::vector<Magick::Image> image_sequence;
+  if (LoadImageAndScale(filename, settings.width, settings.height,
+                        settings.fill_width, settings.fill_height,
+                        &image_sequence, err_msg)) {
+    file_info = new FileInfo();
+    file_info->params = params;
+    file_info->content_stream = new rgb_matrix::MemStreamIO();
+    file_info->is_multi_frame = image_sequence.size() > 1;
+    rgb_matrix::StreamWriter out(file_info->content_stream);
+    for (size_t i = 0; i < image_sequence.size(); ++i) {
+      const Magick::Image &img = image_sequence[i];
+      int64_t delay_time_us;
+      if (file_info->is_multi_frame) {
+        delay_time_us = img.animationDelay() * 10000; // unit in 1/100s
+      } else {
+        delay_time_us = file_info->params.wait_ms * 1000;  // single image.
+      }
+      if (delay_time_us <= 0) delay_time_us = 100 * 1000;  // 1/10sec
+      StoreInStream(img, delay_time_us, settings.do_center,
+                    stream_writer && settings.portable,
+                    scratch, stream_writer ? stream_writer : &out);
+    }
+    if (!cache_file.empty()) {
+      WriteCacheFile(file_info->content_stream, cache_file);
+    }
+    return file_info;
+  }
+
+  // Ok, not an image. Let's see if it is one of our streams.
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    perror("Opening file");
+    return NULL;
+  }
+  file_info = new FileInfo();
+  file_info->params = params;
+  file_info->content_stream = OpenStreamFile(fd, settings.do_mmap);
+  StreamReader reader(file_info->content_stream);
+  if (!reader.GetNext(scratch, NULL)) {  // header+size ok
+    *err_msg += "; Can't read as image or compatible stream";
+    delete file_info->content_stream;
+    delete file_info;
+    return NULL;
+  }
+  file_info->is_multi_frame = reader.GetNext(scratch, NULL);
+  std::vector<rgb_matrix::StreamSegment> segments;
+  if (reader.BuildIndex(&segments) && segments.size() > 1) {
+    fprintf(stderr, "%s: %d segments\n", filename, (int)segments.size());
+    for (size_t s = 0; s < segments.size(); ++s) {
+      fprintf(stderr, "\t%-30s %4d frames %8.3fs x%d\n",
+              segments[s].name.c_str(), segments[s].frames,
+              segments[s].duration_us / 1e6, segments[s].loops);
+    }
+  }
+  reader.Rewind();
+  if (stream_writer) {
+    if (settings.portable) {
+      fprintf(stderr, "%s: can only be added to native streams.\n",
+              filename);
+    } else {
+      CopyStream(&reader, stream_writer, scratch);
+    }
+  } else if (reader.is_rgb()) {
+    // Portable stream: convert to our panel configuration once, so
+    // that playback is as cheap as with a native stream.
+    rgb_matrix::StreamIO *native = new rgb_matrix::MemStreamIO();
+    const bool ok = rgb_matrix::TranscodeStream(file_info->content_stream,
+                                                scratch, native) >= 0;
+    delete file_info->content_stream;
+    file_info->content_stream = native;
+    if (!ok) {
+      *err_msg = "Corrupt or truncated stream";
+      delete file_info->content_stream;
+      delete file_info;
+      return NULL;
+    }
+  }
+  return file_info;
+}
+
+// Playlist adjustments of the display duration.
+static void AdjustForPlaylist(ImageParams *params, int file_count) {
+  if (file_count == 1) {
+    // Single image: show forever.
+    params->wait_ms = distant_future;
+  } else if (params->loops < 0 && params->anim_duration_ms == distant_future) {
+    // Forever animation ? Set to loop only once, otherwise that animation
+    // would just run forever, stopping all the images after it.
+    params->loops = 1;
+  }
+}
+
+// Hands files loaded by background threads to the display.
+class Preloader {
+public:
+  explicit Preloader(int count)
+    : files_(count, nullptr), loaded_(count, false), remaining_(count) {}
+
+  // Set the result of loading file "index"; NULL if it failed. Returns true
+  // for the last file being loaded.
+  bool Set(int index, FileInfo *file) {
+    std::lock_guard<std::mutex> l(mutex_);
+    files_[index] = file;
+    loaded_[index] = true;
+    loaded_changed_.notify_all();
+    return --remaining_ == 0;
+  }
+
+  // Wait until file "index" is loaded. Returns NULL if it could not be
+  // loaded or if we got interrupted while waiting.
+  FileInfo *Get(int index) {
+    std::unique_lock<std::mutex> l(mutex_);
+    while (!loaded_[index] && !interrupt_received) {
+      // Signals don't wake us up, so look for interrupts once in a while.
+      loaded_changed_.wait_for(l, std::chrono::milliseconds(100));
+    }
+    return files_[index];
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable loaded_changed_;
+  std::vector<FileInfo*> files_;
+  std::vector<bool> loaded_;
+  int remaining_;
+};
+
 void DisplayAnimation(const FileInfo *file,
                       RGBMatrix *matrix, FrameCanvas *offscreen_canvas) {
   const tmillis_t duration_ms = (file->is_multi_frame
@@ -182,22 +492,38 @@ void DisplayAnimation(const FileInfo *file,
   int loops = file->params.loops;
   const tmillis_t end_time_ms = GetTimeInMillis() + duration_ms;
   const tmillis_t override_anim_delay = file->params.anim_delay_ms;
+  // Unless overridden, frames are shown at their presentation time, so that
+  // long animations don't accumulate drift from per-frame sleeps.
+  rgb_matrix::PlaybackClock clock;
   for (int k = 0;
        (loops < 0 || k < loops)
          && !interrupt_received
          && GetTimeInMillis() < end_time_ms;
        ++k) {
     uint32_t delay_us = 0;
+    uint64_t loop_end_us = 0;
+    bool clock_started = false;
     while (!interrupt_received && GetTimeInMillis() <= end_time_ms
            && reader.GetNext(offscreen_canvas, &delay_us)) {
-      const tmillis_t anim_delay_ms =
-        override_anim_delay >= 0 ? override_anim_delay : delay_us / 1000;
+      if (override_anim_delay < 0) {
+        const uint64_t pts = reader.presentation_time_us();
+        if (!clock_started) {
+          clock.Start(pts);
+          clock_started = true;
+        }
+        clock.WaitUntil(pts);
+        offscreen_canvas = matrix->SwapOnVSync(offscreen_canvas,
+                                               file->params.vsync_multiple);
+        loop_end_us = pts + delay_us;
+        continue;
+      }
       const tmillis_t start_wait_ms = GetTimeInMillis();
       offscreen_canvas = matrix->SwapOnVSync(offscreen_canvas,
                                              file->params.vsync_multiple);
       const tmillis_t time_already_spent = GetTimeInMillis() - start_wait_ms;
-      SleepMillis(anim_delay_ms - time_already_spent);
+      SleepMillis(override_anim_delay - time_already_spent);
     }
+    if (clock_started) clock.WaitUntil(loop_end_us);  // Hold last frame.
     reader.Rewind();
   }
 }
@@ -208,8 +534,10 @@ static int usage(const char *progname) {
 
   fprintf(stderr, "Options:\n"
           "\t-O<streamfile>            : Output to stream-file instead of matrix (Don't need to be root).\n"
+          "\t-p                        : With -O: write a portable RGB stream that can be played with any panel wiring or pixel mapper.\n"
           "\t-C                        : Center images.\n"
           "\t-m                        : if this is a stream, mmap() it. This can work around IO latencies in SD-card and refilling kernel buffers. This will use physical memory so only use if you have enough to map file size\n"
+          "\t-k<cache-dir>             : Keep converted images in this directory, so that they load fast next time.\n"
 
           "\nThese options affect images FOLLOWING them on the command line,\n"
           "so it is possible to have different options for each image\n"
@@ -266,6 +594,7 @@ int main(int argc, char *argv[]) {
   bool do_forever = false;
   bool do_center = false;
   bool do_shuffle = false;
+  bool portable_stream = false;
 
   // We remember ImageParams for each image, which will change whenever
   // there is a flag modifying them. This map keeps track of filenames
@@ -283,9 +612,10 @@ int main(int argc, char *argv[]) {
   }
 
   const char *stream_output = NULL;
+  const char *cache_dir = NULL;
 
   int opt;
-  while ((opt = getopt(argc, argv, "w:t:l:fr:c:P:LhCR:sO:V:D:m")) != -1) {
+  while ((opt = getopt(argc, argv, "w:t:l:fr:c:P:LhCR:sO:V:D:mpk:")) != -1) {
     switch (opt) {
     case 'w':
       img_param.wait_ms = roundf(atof(optarg) * 1000.0f);
@@ -302,6 +632,12 @@ int main(int argc, char *argv[]) {
     case 'm':
       do_mmap = true;
       break;
+    case 'p':
+      portable_stream = true;
+      break;
+    case 'k':
+      cache_dir = strdup(optarg);
+      break;
     case 'f':
       do_forever = true;
       break;
@@ -386,87 +722,66 @@ int main(int argc, char *argv[]) {
     global_stream_writer = new rgb_matrix::StreamWriter(stream_io);
   }
 
+  LoadSettings settings;
+  settings.width = matrix->width();
+  settings.height = matrix->height();
+  settings.fill_width = fill_width;
+  settings.fill_height = fill_height;
+  settings.do_center = do_center;
+  settings.do_mmap = do_mmap;
+  settings.portable = portable_stream;
+  settings.cache_dir = cache_dir;
+  settings.config_fingerprint = 0;
+  if (cache_dir) {
+    if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST) {
+      perror("Can't create cache directory");
+      settings.cache_dir = NULL;
+    } else {
+      settings.config_fingerprint = ConfigFingerprint(offscreen_canvas);
+    }
+  }
+
   const tmillis_t start_load = GetTimeInMillis();
   fprintf(stderr, "Loading %d files...\n", argc - optind);
   // Preparing all the images beforehand as the Pi might be too slow to
   // be quickly switching between these. So preprocess.
-  std::vector<FileInfo*> file_imgs;
-  for (int imgarg = optind; imgarg < argc; ++imgarg) {
-    const char *filename = argv[imgarg];
-    FileInfo *file_info = NULL;
-
-    std::string err_msg;
-    std::vector<Magick::Image> image_sequence;
-    if (LoadImageAndScale(filename, matrix->width(), matrix->height(),
-                          fill_width, fill_height, &image_sequence, &err_msg)) {
-      file_info = new FileInfo();
-      file_info->params = filename_params[filename];
-      file_info->content_stream = new rgb_matrix::MemStreamIO();
-      file_info->is_multi_frame = image_sequence.size() > 1;
-      rgb_matrix::StreamWriter out(file_info->content_stream);
-      for (size_t i = 0; i < image_sequence.size(); ++i) {
-        const Magick::Image &img = image_sequence[i];
-        int64_t delay_time_us;
-        if (file_info->is_multi_frame) {
-          delay_time_us = img.animationDelay() * 10000; // unit in 1/100s
-        } else {
-          delay_time_us = file_info->params.wait_ms * 1000;  // single image.
-        }
-        if (delay_time_us <= 0) delay_time_us = 100 * 1000;  // 1/10sec
-        StoreInStream(img, delay_time_us, do_center, offscreen_canvas,
-                      global_stream_writer ? global_stream_writer : &out);
-      }
-    } else {
-      // Ok, not an image. Let's see if it is one of our streams.
-      int fd = open(filename, O_RDONLY);
-      if (fd >= 0) {
-        file_info = new FileInfo();
-        file_info->params = filename_params[filename];
-        if (do_mmap) {
-          rgb_matrix::MemMapViewInput *stream_input =
-            new rgb_matrix::MemMapViewInput(fd);
-          if (stream_input->IsInitialized()) {
-            file_info->content_stream = stream_input;
-          } else {
-            delete stream_input;
-          }
-        }
-        if (!file_info->content_stream) {
-          file_info->content_stream = new rgb_matrix::FileStreamIO(fd);
-        }
-        StreamReader reader(file_info->content_stream);
-        if (reader.GetNext(offscreen_canvas, NULL)) {  // header+size ok
-          file_info->is_multi_frame = reader.GetNext(offscreen_canvas, NULL);
-          reader.Rewind();
-          if (global_stream_writer) {
-            CopyStream(&reader, global_stream_writer, offscreen_canvas);
-          }
-        } else {
-          err_msg += "; Can't read as image or compatible stream";
-          delete file_info->content_stream;
-          delete file_info;
-          file_info = NULL;
-        }
-      }
-      else {
-        perror("Opening file");
-      }
-    }
-
-    if (file_info) {
-      file_imgs.push_back(file_info);
-    } else {
-      fprintf(stderr, "%s skipped: Unable to open (%s)\n",
-              filename, err_msg.c_str());
-    }
+  const int file_count = argc - optind;
+  std::vector<ImageParams> params(file_count);
+  for (int i = 0; i < file_count; ++i) {
+    params[i] = filename_params[argv[optind + i]];
   }
 
   if (stream_output) {
+    // Each file becomes a segment of the output stream, so the whole
+    // playlist plays without gaps from a single file. This has to happen
+    // in order. Files that can't be loaded don't write frames, so the
+    // writer drops their segment.
+    int loaded_count = 0;
+    for (int i = 0; i < file_count; ++i) {
+      const char *filename = argv[optind + i];
+      global_stream_writer->BeginSegment(
+        filename, params[i].loops > 0 ? params[i].loops : 1);
+      std::string err_msg;
+      FileInfo *file_info = LoadFile(filename, params[i], settings,
+                                     offscreen_canvas, global_stream_writer,
+                                     &err_msg);
+      if (file_info) {
+        loaded_count++;
+      } else {
+        fprintf(stderr, "%s skipped: Unable to open (%s)\n",
+                filename, err_msg.c_str());
+      }
+    }
     delete global_stream_writer;
     delete stream_io;
-    if (file_imgs.size()) {
-      fprintf(stderr, "Done: Output to stream %s; "
-              "this can now be opened with led-image-viewer with the exact same panel configuration settings such as rows, chain, parallel and hardware-mapping\n", stream_output);
+    if (loaded_count) {
+      if (portable_stream) {
+        fprintf(stderr, "Done: Output to portable stream %s; "
+                "this can now be opened with led-image-viewer on any panel configuration of the same size\n", stream_output);
+      } else {
+        fprintf(stderr, "Done: Output to stream %s; "
+                "this can now be opened with led-image-viewer with the exact same panel configuration settings such as rows, chain, parallel and hardware-mapping\n", stream_output);
+      }
     }
     if (do_shuffle)
       fprintf(stderr, "Note: -s (shuffle) does not have an effect when generating streams.\n");
@@ -476,40 +791,86 @@ int main(int argc, char *argv[]) {
     return 0;
   }
 
-  // Some parameter sanity adjustments.
-  if (file_imgs.empty()) {
-    // e.g. if all files could not be interpreted as image.
-    fprintf(stderr, "No image could be loaded.\n");
-    return 1;
-  } else if (file_imgs.size() == 1) {
-    // Single image: show forever.
-    file_imgs[0]->params.wait_ms = distant_future;
-  } else {
-    for (size_t i = 0; i < file_imgs.size(); ++i) {
-      ImageParams &params = file_imgs[i]->params;
-      // Forever animation ? Set to loop only once, otherwise that animation
-      // would just run forever, stopping all the images after it.
-      if (params.loops < 0 && params.anim_duration_ms == distant_future) {
-        params.loops = 1;
-      }
-    }
-  }
-
-  fprintf(stderr, "Loading took %.3fs; now: Display.\n",
-          (GetTimeInMillis() - start_load) / 1000.0);
-
   signal(SIGTERM, InterruptHandler);
   signal(SIGINT, InterruptHandler);
 
+  // Load and convert on all cores in the background, each loader with its
+  // own canvas. Files are picked up in the order they are shown, so that
+  // the display can start as soon as the first one is ready.
+  std::vector<int> order(file_count);
+  for (int i = 0; i < file_count; ++i) order[i] = i;
+  if (do_shuffle) {
+    std::random_shuffle(order.begin(), order.end());
+  }
+
+  Preloader preloader(file_count);
+  const int thread_count = std::max(1, std::min(
+    file_count, (int)std::thread::hardware_concurrency()));
+  std::vector<FrameCanvas*> scratch(thread_count);
+  for (int t = 0; t < thread_count; ++t) {
+    scratch[t] = matrix->CreateFrameCanvas();
+  }
+  std::atomic<int> next_file(0);
+  std::atomic<bool> stop_loading(false);
+  std::vector<std::thread> loaders;
+  for (int t = 0; t < thread_count; ++t) {
+    loaders.push_back(std::thread([&, t]() {
+      for (int n = next_file++;
+           n < file_count && !stop_loading; n = next_file++) {
+        const int i = order[n];
+        const char *filename = argv[optind + i];
+        std::string err_msg;
+        FileInfo *file_info = LoadFile(filename, params[i], settings,
+                                       scratch[t], NULL, &err_msg);
+        if (file_info) {
+          AdjustForPlaylist(&file_info->params, file_count);
+        } else {
+          fprintf(stderr, "%s skipped: Unable to open (%s)\n",
+                  filename, err_msg.c_str());
+        }
+        if (preloader.Set(i, file_info)) {
+          fprintf(stderr, "Loading took %.3fs\n",
+                  (GetTimeInMillis() - start_load) / 1000.0);
+        }
+      }
+    }));
+  }
+
+  bool first_shown = false;
+  int exit_code = 0;
+  bool first_round = true;
   do {
-    if (do_shuffle) {
-      std::random_shuffle(file_imgs.begin(), file_imgs.end());
+    // After the first round, all files are loaded and the loaders are done
+    // with the order.
+    if (do_shuffle && !first_round) {
+      std::random_shuffle(order.begin(), order.end());
+    }
+    first_round = false;
+    int shown = 0;
+    for (int i = 0; i < file_count && !interrupt_received; ++i) {
+      const FileInfo *file = preloader.Get(order[i]);
+      if (file == NULL) continue;
+      if (!first_shown) {
+        fprintf(stderr, "First file ready after %.3fs; now: Display.\n",
+                (GetTimeInMillis() - start_load) / 1000.0);
+        first_shown = true;
+      }
+      DisplayAnimation(file, matrix, offscreen_canvas);
+      shown++;
     }
-    for (size_t i = 0; i < file_imgs.size() && !interrupt_received; ++i) {
-      DisplayAnimation(file_imgs[i], matrix, offscreen_canvas);
+    if (shown == 0 && !interrupt_received) {
+      // e.g. if all files could not be interpreted as image.
+      fprintf(stderr, "No image could be loaded.\n");
+      exit_code = 1;
+      break;
     }
   } while (do_forever && !interrupt_received);
 
+  stop_loading = true;  // Loaders might still be busy, e.g. on interrupt.
+  for (std::thread &loader : loaders) {
+    loader.join();
+  }
+
   if (interrupt_received) {
     fprintf(stderr, "Caught signal. Exiting.\n");
   }
@@ -519,5 +880,5 @@ int main(int argc, char *argv[]) {
   delete matrix;
 
   // Leaking the FileInfos, but don't care at program end.
-  return 0;
+  return exit_code;
 }
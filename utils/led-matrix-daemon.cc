@@ -0,0 +1,231 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+// Owns the LED matrix and shows the frames another process publishes in
+// shared memory. See include/frame-ring.h for the protocol.
+//
+// The matrix keeps running while producers come and go, so effects can be
+// switched without initializing the panels again and without blanking.
+
+#include "led-matrix.h"
+#include "frame-ring.h"
+
+#include <getopt.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using rgb_matrix::Color;
+using rgb_matrix::FrameCanvas;
+using rgb_matrix::RGBMatrix;
+
+volatile bool interrupt_received = false;
+static void InterruptHandler(int signo) {
+  interrupt_received = true;
+}
+
+static uint32_t RoundUp(uint32_t value, uint32_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// The frame ring as we created it. Any user can write to the shared
+// memory, so apart from write_seq, we don't read anything back from it.
+struct FrameRing {
+  LedFrameRingHeader *header;
+  uint8_t *slots;
+  uint32_t slot_count;
+  uint32_t slot_stride;
+};
+
+// Returns if the shared memory "name" is the frame ring of a daemon that
+// is still running.
+static bool IsInUse(const char *name) {
+  const int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  void *mem = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(LedFrameRingHeader)) {
+    mem = mmap(NULL, sizeof(LedFrameRingHeader), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (mem == MAP_FAILED) return false;
+  const LedFrameRingHeader *header = (const LedFrameRingHeader*)mem;
+  const pid_t pid = header->daemon_pid;
+  const bool in_use = (header->magic == LED_FRAME_RING_MAGIC && pid > 0
+                       && pid != getpid()
+                       && (kill(pid, 0) == 0 || errno != ESRCH));
+  munmap(mem, sizeof(LedFrameRingHeader));
+  return in_use;
+}
+
+// Create the shared memory with the frame ring for frames of the given
+// size. Returns false on failure.
+static bool CreateFrameRing(const char *name, int width, int height,
+                            int slot_count, FrameRing *ring) {
+  const uint32_t kCacheLine = 64;
+  const uint32_t first_slot = RoundUp(sizeof(LedFrameRingHeader), kCacheLine);
+  const uint32_t slot_stride = RoundUp(width * height * 3, kCacheLine);
+  const uint32_t total_size = first_slot + slot_count * slot_stride;
+
+  if (IsInUse(name)) {
+    fprintf(stderr, "%s is in use by another running daemon.\n", name);
+    return false;
+  }
+  shm_unlink(name);  // Left over from an earlier run.
+  const int fd = shm_open(name, O_CREAT|O_EXCL|O_RDWR, 0666);
+  if (fd < 0) {
+    perror("Can't create shared memory");
+    return false;
+  }
+  fchmod(fd, 0666);  // Any user may publish frames, regardless of umask.
+  if (ftruncate(fd, total_size) < 0) {
+    perror("Can't size shared memory");
+    close(fd);
+    return false;
+  }
+  void *mem = mmap(NULL, total_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    perror("Can't map shared memory");
+    return false;
+  }
+
+  LedFrameRingHeader *header = (LedFrameRingHeader*)mem;
+  header->version = LED_FRAME_RING_VERSION;
+  header->width = width;
+  header->height = height;
+  header->slot_count = slot_count;
+  header->slot_stride = slot_stride;
+  header->first_slot = first_slot;
+  header->total_size = total_size;
+  header->daemon_pid = getpid();
+  // Last, so that producers only see a fully initialized header.
+  __atomic_store_n(&header->magic, LED_FRAME_RING_MAGIC, __ATOMIC_RELEASE);
+
+  ring->header = header;
+  ring->slots = (uint8_t*)mem + first_slot;
+  ring->slot_count = slot_count;
+  ring->slot_stride = slot_stride;
+  return true;
+}
+
+static int usage(const char *progname) {
+  fprintf(stderr, "usage: %s [options]\n", progname);
+  fprintf(stderr, "Show frames other processes publish in shared memory.\n");
+  fprintf(stderr, "Options:\n"
+          "\t-n<name>    : Name of the shared memory (default: %s).\n"
+          "\t-s<slots>   : Number of frame slots (default: 3).\n"
+          "\t-v          : Verbose: report frame counts on exit.\n",
+          LED_FRAME_RING_DEFAULT_NAME);
+  fprintf(stderr, "\nGeneral LED matrix options:\n");
+  rgb_matrix::PrintMatrixFlags(stderr);
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  RGBMatrix::Options matrix_options;
+  rgb_matrix::RuntimeOptions runtime_opt;
+  if (!rgb_matrix::ParseOptionsFromFlags(&argc, &argv,
+                                         &matrix_options, &runtime_opt)) {
+    return usage(argv[0]);
+  }
+
+  const char *ring_name = LED_FRAME_RING_DEFAULT_NAME;
+  int slot_count = 3;
+  bool verbose = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:s:v")) != -1) {
+    switch (opt) {
+    case 'n': ring_name = strdup(optarg); break;
+    case 's': slot_count = atoi(optarg); break;
+    case 'v': verbose = true; break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+
+  if (slot_count < 2 || slot_count > 64) {
+    fprintf(stderr, "Number of slots needs to be between 2 and 64.\n");
+    return 1;
+  }
+
+  RGBMatrix *matrix = RGBMatrix::CreateFromOptions(matrix_options,
+                                                   runtime_opt);
+  if (matrix == NULL)
+    return 1;
+
+  const int width = matrix->width();
+  const int height = matrix->height();
+  FrameRing ring;
+  if (!CreateFrameRing(ring_name, width, height, slot_count, &ring)) {
+    delete matrix;
+    return 1;
+  }
+  fprintf(stderr, "Showing %dx%d frames published to %s\n",
+          width, height, ring_name);
+
+  signal(SIGTERM, InterruptHandler);
+  signal(SIGINT, InterruptHandler);
+
+  FrameCanvas *canvas = matrix->CreateFrameCanvas();
+  uint32_t shown_seq = 0;
+  uint32_t shown_count = 0;
+  LedFrameRingHeader *const header = ring.header;
+  while (!interrupt_received) {
+    const uint32_t seq = __atomic_load_n(&header->write_seq, __ATOMIC_ACQUIRE);
+    if (seq == shown_seq) {
+      // Wait for the doorbell; look for interrupts once in a while.
+      struct timespec timeout = { 0, 100000000 };
+      led_frame_ring_futex(&header->write_seq, FUTEX_WAIT, seq, &timeout);
+      continue;
+    }
+
+    const uint32_t newest = seq - 1;
+    if (seq - shown_seq > ring.slot_count) {
+      // More frames than slots since we last looked: the producer doesn't
+      // wait for free slots, so the frame might be half written. Skip it.
+      __atomic_store_n(&header->read_seq, seq, __ATOMIC_RELEASE);
+      led_frame_ring_futex(&header->read_seq, FUTEX_WAKE, INT_MAX, NULL);
+      shown_seq = seq;
+      continue;
+    }
+
+    // Show the newest frame; all before it are done with. Its slot stays
+    // ours until we advance read_seq past it.
+    __atomic_store_n(&header->read_seq, newest, __ATOMIC_RELEASE);
+    const uint8_t *pixels =
+      ring.slots + (size_t)(newest % ring.slot_count) * ring.slot_stride;
+    canvas->SetPixels(0, 0, width, height, (const Color*)pixels);
+    __atomic_store_n(&header->read_seq, seq, __ATOMIC_RELEASE);
+    led_frame_ring_futex(&header->read_seq, FUTEX_WAKE, INT_MAX, NULL);
+
+    canvas = matrix->SwapOnVSync(canvas);
+    shown_seq = seq;
+    shown_count++;
+  }
+
+  if (verbose) {
+    fprintf(stderr, "%u frames published, %u shown\n",
+            shown_seq, shown_count);
+  }
+
+  shm_unlink(ring_name);
+  matrix->Clear();
+  delete matrix;
+  return 0;
+}
@@ -0,0 +1,98 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+// Copyright (C) 2026 The hoolacane-rpi-led-matrix authors
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation version 2.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://gnu.org/licenses/gpl-2.0.txt>
+
+// Flatten the pixel mappers given with --led-pixel-mapper into a file that
+// can then be used with --led-pixel-mapper="File:<filename>"
+
+#include "led-matrix.h"
+#include "pixel-mapper.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace rgb_matrix;
+
+static int usage(const char *progname) {
+  fprintf(stderr, "usage: %s [options] -o <mapping-file>\n", progname);
+  fprintf(stderr, "Writes the pixel mappers given with --led-pixel-mapper "
+          "to a file\nthat can be used with "
+          "--led-pixel-mapper=\"File:<mapping-file>\" with the same\n"
+          "panel settings (rows, cols, chain, parallel, multiplexing).\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr,
+          "\t-o <mapping-file> : Output file.\n"
+          "\n"
+          );
+  rgb_matrix::PrintMatrixFlags(stderr);
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  RGBMatrix::Options matrix_options;
+  rgb_matrix::RuntimeOptions runtime_opt;
+  // We don't access the hardware, so these are not needed.
+  runtime_opt.daemon = -1;
+  runtime_opt.drop_privileges = -1;
+  runtime_opt.do_gpio_init = false;
+  if (!rgb_matrix::ParseOptionsFromFlags(&argc, &argv,
+                                         &matrix_options, &runtime_opt)) {
+    return usage(argv[0]);
+  }
+
+  const char *output_file = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:")) != -1) {
+    switch (opt) {
+    case 'o': output_file = optarg; break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+
+  if (output_file == NULL) {
+    fprintf(stderr, "Need output file with -o\n");
+    return usage(argv[0]);
+  }
+  if (matrix_options.pixel_mapper_config == NULL
+      || strlen(matrix_options.pixel_mapper_config) == 0) {
+    fprintf(stderr, "Need pixel mappers with --led-pixel-mapper\n");
+    return usage(argv[0]);
+  }
+
+  // We only need the size of the matrix with multiplexing applied, but
+  // none of the pixel mappers.
+  const char *pixel_mapper_config = matrix_options.pixel_mapper_config;
+  matrix_options.pixel_mapper_config = NULL;
+  RGBMatrix *matrix = RGBMatrix::CreateFromOptions(matrix_options,
+                                                   runtime_opt);
+  if (matrix == NULL)
+    return 1;
+  const int width = matrix->width();
+  const int height = matrix->height();
+  delete matrix;
+
+  if (!WritePixelMapperFile(output_file, pixel_mapper_config,
+                            matrix_options.chain_length,
+                            matrix_options.parallel, width, height)) {
+    fprintf(stderr, "Could not write %s\n", output_file);
+    return 1;
+  }
+  fprintf(stderr, "Wrote mapping for %dx%d matrix to %s. Use with\n"
+          "\t--led-pixel-mapper=\"File:%s\"\n",
+          width, height, output_file, output_file);
+  return 0;
+}
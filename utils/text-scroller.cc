@@ -262,7 +262,18 @@ int main(int argc, char *argv[]) {
 
   int x = x_orig;
   int y = y_orig;
-  int length = 0;
+
+  // The text is only rendered when it changes, each frame just copies the
+  // visible part.
+  rgb_matrix::TextStrip strip;
+  // length = holds how many pixels our text takes up
+  int length = strip.SetText(font, line.c_str(), color, bg_color,
+                             letter_spacing, outline_font, outline_color);
+
+  // Consecutive frames only differ by one column, so we copy the frame
+  // that is shown and only draw the column that scrolled in.
+  FrameCanvas *shown_canvas = NULL;   // NULL if it can't be reused.
+  int shown_x = 0;
 
   struct timespec next_frame = {0, 0};
 
@@ -270,29 +281,30 @@ int main(int argc, char *argv[]) {
   while (!interrupt_received && loops != 0) {
     if (input_file && ReadLineOnChange(input_file, &line, &last_change)) {
       x = x_orig;
+      length = strip.SetText(font, line.c_str(), color, bg_color,
+                             letter_spacing, outline_font, outline_color);
+      shown_canvas = NULL;
     }
     ++frame_counter;
-    offscreen_canvas->Fill(bg_color.r, bg_color.g, bg_color.b);
     const bool draw_on_frame = (blink_on <= 0)
       || (frame_counter % (blink_on + blink_off) < (uint64_t)blink_on);
 
-    if (draw_on_frame) {
-      if (outline_font) {
-        // The outline font, we need to write with a negative (-2) text-spacing,
-        // as we want to have the same letter pitch as the regular text that
-        // we then write on top.
-        rgb_matrix::DrawText(offscreen_canvas, *outline_font,
-                             x - 1, y + font.baseline(),
-                             outline_color, NULL,
-                             line.c_str(), letter_spacing - 2);
+    if (draw_on_frame && shown_canvas && shown_x + scroll_direction == x) {
+      const int new_column = scroll_direction < 0 ? canvas->width() - 1 : 0;
+      offscreen_canvas->Blit(*shown_canvas, 0, 0,
+                             canvas->width(), canvas->height(),
+                             scroll_direction, 0);
+      offscreen_canvas->FillRect(new_column, 0, 1, canvas->height(),
+                                 bg_color.r, bg_color.g, bg_color.b);
+      strip.DrawColumns(offscreen_canvas, x, y, new_column, 1);
+    } else {
+      offscreen_canvas->Fill(bg_color.r, bg_color.g, bg_color.b);
+      if (draw_on_frame) {
+        strip.Draw(offscreen_canvas, x, y);
       }
-
-      // length = holds how many pixels our text takes up
-      length = rgb_matrix::DrawText(offscreen_canvas, font,
-                                    x, y + font.baseline(),
-                                    color, NULL,
-                                    line.c_str(), letter_spacing);
     }
+    FrameCanvas *const drawn_canvas = draw_on_frame ? offscreen_canvas : NULL;
+    const int drawn_x = x;
 
     x += scroll_direction;
     if ((scroll_direction < 0 && x + length < 0) ||
@@ -313,6 +325,8 @@ int main(int argc, char *argv[]) {
     }
     // Swap the offscreen_canvas with canvas on vsync, avoids flickering
     offscreen_canvas = canvas->SwapOnVSync(offscreen_canvas);
+    shown_canvas = drawn_canvas;
+    shown_x = drawn_x;
     if (speed <= 0) pause();  // Nothing to scroll.
   }
 
@@ -46,11 +46,16 @@ extern "C" {
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
 
 #include "led-matrix.h"
 #include "content-streamer.h"
 
+using rgb_matrix::Color;
 using rgb_matrix::FrameCanvas;
 using rgb_matrix::RGBMatrix;
 using rgb_matrix::StreamWriter;
@@ -61,18 +66,183 @@ static void InterruptHandler(int) {
   interrupt_received = true;
 }
 
-struct LedPixel {
-  uint8_t r, g, b;
-};
-void CopyFrame(AVFrame *pFrame, FrameCanvas *canvas,
+// The RGB24 rows sws_scale() produces have the memory layout of Color.
+static_assert(sizeof(Color) == 3, "Color is expected to be packed RGB24");
+
+// Copy the RGB24 "frame" to the canvas. The rows go straight from the
+// frame's line pointers to the bulk bitplane conversion of SetPixels(); all
+// rows at once if there is no padding between them. The output frame we
+// allocate has its rows aligned for sws_scale(), so usually it is one call
+// per row.
+void CopyFrame(const AVFrame *frame, FrameCanvas *canvas,
                int offset_x, int offset_y,
                int width, int height) {
-  for (int y = 0; y < height; ++y) {
-    LedPixel *pix = (LedPixel*) (pFrame->data[0] + y*pFrame->linesize[0]);
-    for (int x = 0; x < width; ++x, ++pix) {
-      canvas->SetPixel(x + offset_x, y + offset_y, pix->r, pix->g, pix->b);
+  const uint8_t *row = frame->data[0];
+  const int stride = frame->linesize[0];
+  if (stride == width * (int)sizeof(Color)) {
+    canvas->SetPixels(offset_x, offset_y, width, height, (const Color*)row);
+    return;
+  }
+  for (int y = 0; y < height; ++y, row += stride) {
+    canvas->SetPixels(offset_x, offset_y + y, width, 1, (const Color*)row);
+  }
+}
+
+// A bounded queue connecting two stages of the playback pipeline.
+// Once closed, Push() fails and Pop() only returns what is left, so that
+// all stages wind down.
+template <class T>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity), closed_(false) {}
+
+  // Waits while full. Returns false if closed; item is not queued then.
+  bool Push(const T &item) {
+    std::unique_lock<std::mutex> l(mutex_);
+    not_full_.wait(l, [this]() { return closed_ || queue_.size() < capacity_; });
+    if (closed_) return false;
+    queue_.push_back(item);
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Waits while empty. Returns false once closed and empty.
+  bool Pop(T *item) {
+    std::unique_lock<std::mutex> l(mutex_);
+    not_empty_.wait(l, [this]() { return closed_ || !queue_.empty(); });
+    if (queue_.empty()) return false;
+    *item = queue_.front();
+    queue_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> l(mutex_);
+    closed_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+private:
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> queue_;
+  bool closed_;
+};
+
+// Playback runs in three stages, each in its own thread, so that decoding
+// and converting the next frames can use other cores while a frame is
+// shown:
+//   decode thread  -> decoded frames ->
+//   convert thread (scale, copy to FrameCanvas) -> converted canvases ->
+//   presenter (main thread) -> back to the free canvases.
+static const size_t kDecodeQueueSize = 4;
+static const size_t kConvertQueueSize = 2;
+// One canvas being converted plus the ones waiting to be shown.
+static const size_t kFreeCanvases = kConvertQueueSize + 1;
+
+// All the state of playing a video once.
+struct Playback {
+  Playback() : decoded(kDecodeQueueSize), converted(kConvertQueueSize) {}
+
+  // Used by the decode thread.
+  AVFormatContext *format_context;
+  AVCodecContext *codec_context;
+  int video_stream;
+  unsigned int frame_skip;
+  int64_t frame_limit;
+
+  // Used by the convert thread.
+  SwsContext *sws_ctx;
+  AVFrame *output_frame;
+  int display_offset_x, display_offset_y;
+  int display_width, display_height;
+
+  BoundedQueue<AVFrame*> decoded;
+  BoundedQueue<FrameCanvas*> converted;
+  BoundedQueue<FrameCanvas*> *free_canvases;
+};
+
+static void DecodeFrames(Playback *p) {
+  AVPacket *packet = av_packet_alloc();
+  AVFrame *decode_frame = av_frame_alloc();  // Decode video into this
+  int64_t frames_left = p->frame_limit;
+  unsigned int frames_to_skip = p->frame_skip;
+  int decode_in_flight = 0;
+  bool state_reading = true;
+  bool receiver_gone = false;
+
+  while (!interrupt_received && !receiver_gone && frames_left > 0) {
+    if (state_reading &&
+        av_read_frame(p->format_context, packet) != 0) {
+      state_reading = false;  // ran out of packets from input
+    }
+
+    if (!state_reading && decode_in_flight == 0)
+      break;  // Decoder fully drained.
+
+    // Is this a packet from the video stream?
+    if (state_reading && packet->stream_index != p->video_stream) {
+      av_packet_unref(packet);
+      continue;  // Not interested in that.
+    }
+
+    if (state_reading) {
+      // Decode video frame
+      if (avcodec_send_packet(p->codec_context, packet) == 0) {
+        ++decode_in_flight;
+      }
+      av_packet_unref(packet);
+    } else {
+      avcodec_send_packet(p->codec_context, nullptr); // Trigger decode drain
+    }
+
+    while (decode_in_flight && frames_left > 0 &&
+           avcodec_receive_frame(p->codec_context, decode_frame) == 0) {
+      --decode_in_flight;
+
+      if (frames_to_skip) { frames_to_skip--; continue; }
+
+      AVFrame *frame = av_frame_alloc();
+      av_frame_move_ref(frame, decode_frame);
+      if (!p->decoded.Push(frame)) {
+        av_frame_free(&frame);
+        receiver_gone = true;
+        break;
+      }
+      frames_left--;
+    }
+  }
+  p->decoded.Close();
+
+  av_frame_free(&decode_frame);
+  av_packet_free(&packet);
+}
+
+static void ConvertFrames(Playback *p) {
+  AVFrame *frame;
+  while (p->decoded.Pop(&frame)) {
+    FrameCanvas *canvas;
+    p->free_canvases->Pop(&canvas);  // Presenter always gives them back.
+
+    // Convert the image from its native format to RGB
+    sws_scale(p->sws_ctx, (uint8_t const * const *)frame->data,
+              frame->linesize, 0, frame->height,
+              p->output_frame->data, p->output_frame->linesize);
+    av_frame_free(&frame);
+    CopyFrame(p->output_frame, canvas,
+              p->display_offset_x, p->display_offset_y,
+              p->display_width, p->display_height);
+
+    if (!p->converted.Push(canvas)) {
+      p->free_canvases->Push(canvas);
+      break;
     }
   }
+  p->converted.Close();
 }
 
 // Scale "width" and "height" to fit within target rectangle of given size.
@@ -119,6 +289,11 @@ static void add_nanos(struct timespec *accumulator, long nanoseconds) {
   }
 }
 
+static bool is_after(const struct timespec &a, const struct timespec &b) {
+  return (a.tv_sec > b.tv_sec
+          || (a.tv_sec == b.tv_sec && a.tv_nsec > b.tv_nsec));
+}
+
 // Convert deprecated color formats to new and manually set the color range.
 // YUV has funny ranges (16-235), while the YUVJ are 0-255. SWS prefers to
 // deal with the YUV range, but then requires to set the output range.
@@ -243,9 +418,13 @@ int main(int argc, char *argv[]) {
   if (matrix == NULL) {
     return 1;
   }
-  FrameCanvas *offscreen_canvas = matrix->CreateFrameCanvas();
+  BoundedQueue<FrameCanvas*> free_canvases(kFreeCanvases);
+  for (size_t i = 0; i < kFreeCanvases; ++i) {
+    free_canvases.Push(matrix->CreateFrameCanvas());
+  }
 
   long frame_count = 0;
+  long dropped_count = 0;
   StreamIO *stream_io = NULL;
   StreamWriter *stream_writer = NULL;
   if (stream_output_fd >= 0) {
@@ -346,7 +525,9 @@ int main(int argc, char *argv[]) {
       const int display_offset_x = (matrix->width() - display_width)/2;
       const int display_offset_y = (matrix->height() - display_height)/2;
 
-      // The output_frame_ will receive the scaled result.
+      // The output_frame_ will receive the scaled result. It is the one
+      // scratch buffer for the whole video, aligned for sws_scale(); with
+      // unaligned rows, it falls back to a slower path.
       AVFrame *output_frame = av_frame_alloc();
       if (av_image_alloc(output_frame->data, output_frame->linesize,
                          display_width, display_height, AV_PIX_FMT_RGB24,
@@ -371,84 +552,83 @@ int main(int argc, char *argv[]) {
       }
 
 
-      struct timespec next_frame;
-
-      AVPacket *packet = av_packet_alloc();
-      AVFrame *decode_frame = av_frame_alloc();  // Decode video into this
       do {
-        int64_t frames_left = framecount_limit;
-        unsigned int frames_to_skip = frame_skip;
         if (one_video_forever) {
           av_seek_frame(format_context, videoStream, 0, AVSEEK_FLAG_ANY);
           avcodec_flush_buffers(codec_context);
         }
-        clock_gettime(CLOCK_MONOTONIC, &next_frame);
-
-        int decode_in_flight = 0;
-        bool state_reading = true;
 
-        while (!interrupt_received && frames_left > 0) {
-          if (state_reading &&
-              av_read_frame(format_context, packet) != 0) {
-            state_reading = false;  // ran out of packets from input
+        Playback playback;
+        playback.format_context = format_context;
+        playback.codec_context = codec_context;
+        playback.video_stream = videoStream;
+        playback.frame_skip = frame_skip;
+        playback.frame_limit = framecount_limit;
+        playback.sws_ctx = sws_ctx;
+        playback.output_frame = output_frame;
+        playback.display_offset_x = display_offset_x;
+        playback.display_offset_y = display_offset_y;
+        playback.display_width = display_width;
+        playback.display_height = display_height;
+        playback.free_canvases = &free_canvases;
+
+        std::thread decode_thread(DecodeFrames, &playback);
+        std::thread convert_thread(ConvertFrames, &playback);
+
+        // The presenter. Frames are due on an absolute clock, started with
+        // the first frame, so that we don't include the decoding start-up.
+        struct timespec next_frame;
+        bool first_frame = true;
+        FrameCanvas *canvas;
+        while (!interrupt_received && playback.converted.Pop(&canvas)) {
+          if (first_frame) {
+            clock_gettime(CLOCK_MONOTONIC, &next_frame);
+            first_frame = false;
           }
-
-          if (!state_reading && decode_in_flight == 0)
-            break;  // Decoder fully drained.
-
-          // Is this a packet from the video stream?
-          if (state_reading && packet->stream_index != videoStream) {
-            av_packet_unref(packet);
-            continue;  // Not interested in that.
+          // Absolute end of this frame.
+          add_nanos(&next_frame, frame_wait_nanos);
+          frame_count++;
+
+          if (stream_writer) {
+            if (verbose) fprintf(stderr, "%6ld", frame_count);
+            stream_writer->Stream(*canvas, frame_wait_nanos/1000);
+            free_canvases.Push(canvas);
+            continue;
           }
 
-          if (state_reading) {
-            // Decode video frame
-            if (avcodec_send_packet(codec_context, packet) == 0) {
-              ++decode_in_flight;
+          if (!use_vsync_for_frame_timing) {
+            // If the time of this frame already passed, showing it would
+            // only delay all the following; skip it to catch up.
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (is_after(now, next_frame)) {
+              dropped_count++;
+              free_canvases.Push(canvas);
+              continue;
             }
-            av_packet_unref(packet);
-          } else {
-            avcodec_send_packet(codec_context, nullptr); // Trigger decode drain
           }
 
-          while (decode_in_flight &&
-                 avcodec_receive_frame(codec_context, decode_frame) == 0) {
-            --decode_in_flight;
-
-            if (frames_to_skip) { frames_to_skip--; continue; }
-
-            // Determine absolute end of this frame now so that we don't include
-            // decoding overhead. TODO: skip frames if getting too slow ?
-            add_nanos(&next_frame, frame_wait_nanos);
-
-            // Convert the image from its native format to RGB
-            sws_scale(sws_ctx, (uint8_t const * const *)decode_frame->data,
-                      decode_frame->linesize, 0, codec_context->height,
-                      output_frame->data, output_frame->linesize);
-            CopyFrame(output_frame, offscreen_canvas,
-                      display_offset_x, display_offset_y,
-                      display_width, display_height);
-            frame_count++;
-            frames_left--;
-            if (stream_writer) {
-              if (verbose) fprintf(stderr, "%6ld", frame_count);
-              stream_writer->Stream(*offscreen_canvas, frame_wait_nanos/1000);
-            } else {
-              offscreen_canvas = matrix->SwapOnVSync(offscreen_canvas,
-                                                     vsync_multiple);
-            }
-            if (!stream_writer && !use_vsync_for_frame_timing) {
-              clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_frame, NULL);
-            }
+          free_canvases.Push(matrix->SwapOnVSync(canvas, vsync_multiple));
+          if (!use_vsync_for_frame_timing) {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_frame, NULL);
           }
         }
-      } while (one_video_forever && !interrupt_received);
 
-      av_packet_free(&packet);
+        // Wind down the pipeline; give back all canvases still in it.
+        playback.decoded.Close();
+        playback.converted.Close();
+        while (playback.converted.Pop(&canvas))
+          free_canvases.Push(canvas);
+        decode_thread.join();
+        convert_thread.join();
+        AVFrame *unused_frame;
+        while (playback.decoded.Pop(&unused_frame))
+          av_frame_free(&unused_frame);
+      } while (one_video_forever && !interrupt_received);
 
+      sws_freeContext(sws_ctx);
+      av_freep(&output_frame->data[0]);
       av_frame_free(&output_frame);
-      av_frame_free(&decode_frame);
       avcodec_close(codec_context);
       avformat_close_input(&format_context);
     }
@@ -463,7 +643,10 @@ int main(int argc, char *argv[]) {
   delete matrix;
   delete stream_writer;
   delete stream_io;
-  fprintf(stderr, "Total of %ld frames decoded\n", frame_count);
+  fprintf(stderr, "Total of %ld frames decoded", frame_count);
+  if (dropped_count > 0)
+    fprintf(stderr, ", %ld dropped as they were late", dropped_count);
+  fprintf(stderr, "\n");
 
   return 0;
 }